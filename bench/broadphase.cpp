@@ -0,0 +1,52 @@
+// Benchmarks Environment::update with each broad phase over a range of Joint densities.
+// Gravity is off so the Joints stay spread evenly, like a gas.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// Runs a scene and returns the milliseconds per step.
+double run(BroadPhase broadPhase, int count, float density, int steps) {
+	// Size the square environment so the Joints (radius 10 to 20) cover the requested fraction of it.
+	float area = count * M_PI * 15 * 15 / density;
+	int side = sqrt(area);
+	Environment *env = new Environment(side, side, Vector{0, 0}, broadPhase);
+	env->setAllowAccelerate(false);
+	env->setAllowDrag(false);
+	
+	std::mt19937 engine(42);
+	std::uniform_real_distribution<float> sizeDist(10, 20);
+	std::uniform_real_distribution<float> posDist(20, side - 20);
+	std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+	for (int i = 0; i < count; i++) {
+		env->addJoint(posDist(engine), posDist(engine), sizeDist(engine), 100, 1, angleDist(engine), 1);
+	}
+	
+	env->update();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < steps; i++) {
+		env->update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	delete env;
+	return std::chrono::duration<double, std::milli>(end - start).count() / steps;
+}
+
+int main() {
+	const int counts[] = {10000, 100000};
+	const float densities[] = {0.02, 0.1, 0.3};
+	const int steps = 20;
+	
+	printf("%8s %8s %12s %12s %12s %12s\n", "joints", "density", "quadtree ms", "grid ms", "sweep ms", "linear ms");
+	for (int count : counts) {
+		for (float density : densities) {
+			double quadTree = run(BroadPhase::QuadTree, count, density, steps);
+			double grid = run(BroadPhase::Grid, count, density, steps);
+			double sweep = run(BroadPhase::SweepAndPrune, count, density, steps);
+			double linear = run(BroadPhase::LinearQuadTree, count, density, steps);
+			printf("%8d %8.2f %12.3f %12.3f %12.3f %12.3f\n", count, density, quadTree, grid, sweep, linear);
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
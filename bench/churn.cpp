@@ -0,0 +1,49 @@
+// Benchmarks spawning and removing Joints, the pattern of emitters and absorbers.
+// Each step removes a share of the Joints through stale-safe handles and spawns as many again.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+int main() {
+	const int counts[] = {10000, 100000};
+	const int steps = 50;
+	
+	for (int count : counts) {
+		Environment *env = new Environment(8000, 6000, Vector{static_cast<float>(M_PI), 0.2});
+		std::mt19937 engine(42);
+		std::uniform_real_distribution<float> xDist(20, env->getWidth() - 20);
+		std::uniform_real_distribution<float> yDist(20, env->getHeight() - 20);
+		std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+		std::vector<JointHandle> handles;
+		for (int i = 0; i < count; i++) {
+			handles.push_back(env->getHandle(env->addJoint(xDist(engine), yDist(engine), 5, 100, 2, angleDist(engine), 0.9)));
+		}
+		
+		// Replace a tenth of the Joints every step, some of them with a spring to a neighbour.
+		const int churn = count / 10;
+		double churnMs = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < steps; i++) {
+			env->update();
+			auto churnStart = std::chrono::steady_clock::now();
+			for (int k = 0; k < churn; k++) {
+				JointHandle &handle = handles[engine() % handles.size()];
+				env->removeJoint(handle);
+				Joint *joint = env->addJoint(xDist(engine), yDist(engine), 5, 100, 2, angleDist(engine), 0.9);
+				Joint *other = env->getJoint(handles[engine() % handles.size()]);
+				if (k % 4 == 0 && other) {
+					env->addSpring(joint, other, 20);
+				}
+				handle = env->getHandle(joint);
+			}
+			churnMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - churnStart).count();
+		}
+		auto end = std::chrono::steady_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count() / steps;
+		printf("%8d joints: %9.3f ms/step  %9.3f ms churn/step  %7.2f ns/replacement\n", count, ms, churnMs / steps, churnMs * 1e6 / steps / churn);
+		delete env;
+	}
+	
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+// Benchmarks changing the Environment from other threads while it updates, as network or input threads do.
+// Producer threads send a burst of spawns, removals, impulses and moves every 2 milliseconds, spawning as
+// many Joints as they remove. "mutex" applies them directly under a lock the updating thread also holds
+// around each update, as callers had to before; "queue" pushes them with the queue functions
+// (queueAddJoint and the like), which never wait, to be applied as the next update starts. Reports the
+// time per update, the longest a producer took to send one burst, and the commands sent per second.
+#include "../include/cpparticles.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const int joints = 20000;
+static const int steps = 200;
+static const int producers = 3;
+static const int burst = 20;
+
+struct Result {
+	size_t sent = 0;
+	double longestBurst = 0;
+};
+
+// Sends bursts on schedule until told to stop; a burst held up past its time is sent at once.
+// Each producer removes only its own share of the starting Joints.
+static void produce(Environment *env, bool queue, std::mutex &lock, const std::vector<JointHandle> &handles, int producer,
+		const std::atomic<bool> &stop, Result &result) {
+	std::mt19937 engine(producer);
+	std::uniform_int_distribution<size_t> pick(0, handles.size() - 1);
+	std::uniform_real_distribution<float> position(100, 1900);
+	size_t removed = producer;
+	auto next = std::chrono::steady_clock::now();
+	while (!stop) {
+		std::this_thread::sleep_until(next);
+		next += std::chrono::milliseconds(2);
+		auto start = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+		if (!queue) {
+			guard.lock();
+		}
+		for (int i = 0; i < burst; i++) {
+			JointHandle handle = handles[pick(engine)];
+			switch (i % 4) {
+			case 0:
+				if (queue) {
+					env->queueAddJoint(position(engine), position(engine), 3, 10);
+				} else {
+					env->addJoint(position(engine), position(engine), 3, 10);
+				}
+				break;
+			case 1:
+				if (removed < handles.size()) {
+					if (queue) {
+						env->queueRemoveJoint(handles[removed]);
+					} else {
+						env->removeJoint(handles[removed]);
+					}
+					removed += producers;
+				}
+				break;
+			case 2:
+				if (queue) {
+					env->queueImpulse(handle, 5, -5);
+				} else if (Joint *joint = env->getJoint(handle)) {
+					joint->accelerate(5 / joint->getMass(), -5 / joint->getMass());
+				}
+				break;
+			case 3:
+				if (queue) {
+					env->queueMoveTo(handle, 1000, 1000);
+				} else if (Joint *joint = env->getJoint(handle)) {
+					joint->moveTo(1000, 1000);
+				}
+				break;
+			}
+		}
+		if (guard.owns_lock()) {
+			guard.unlock();
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		result.longestBurst = std::max(result.longestBurst, ms);
+		result.sent += burst;
+	}
+}
+
+static void run(bool queue) {
+	Environment *env = new Environment(2000, 2000, Vector{0, 0});
+	env->setAllowAccelerate(false);
+	std::mt19937 engine(42);
+	std::uniform_real_distribution<float> position(100, 1900);
+	std::vector<JointHandle> handles;
+	for (int i = 0; i < joints; i++) {
+		handles.push_back(env->getHandle(env->addJoint(position(engine), position(engine), 3, 10, 1, i, 0.9)));
+	}
+
+	std::mutex lock;
+	std::atomic<bool> stop(false);
+	std::vector<Result> results(producers);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < producers; i++) {
+		threads.emplace_back(produce, env, queue, std::ref(lock), std::cref(handles), i, std::cref(stop), std::ref(results[i]));
+	}
+	double longestUpdate = 0;
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < steps; i++) {
+		auto start = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+		if (!queue) {
+			guard.lock();
+		}
+		env->update();
+		if (guard.owns_lock()) {
+			guard.unlock();
+		}
+		longestUpdate = std::max(longestUpdate, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	stop = true;
+	size_t sent = 0;
+	double longestBurst = 0;
+	for (int i = 0; i < producers; i++) {
+		threads[i].join();
+		sent += results[i].sent;
+		longestBurst = std::max(longestBurst, results[i].longestBurst);
+	}
+	printf("%8s %12.3f %12.3f %14.3f %14.0f %8zu\n", queue ? "queue" : "mutex", elapsed / steps, longestUpdate, longestBurst,
+		sent / (elapsed / 1000), env->getJoints().size());
+	delete env;
+}
+
+int main() {
+	printf("%8s %12s %12s %14s %14s %8s\n", "changes", "ms/update", "longest ms", "longest burst", "commands/s", "joints");
+	run(false);
+	run(true);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+// Benchmarks multi-rate stepping against uniform steps on the gas_cloud demo's configuration:
+// Joints of mass 1 to 5 at rest, pulled together by Barnes-Hut attraction and combining on contact.
+// As in the demo, a Joint absorbed by another is removed after each update. The remaining Joints and
+// the radius of the cloud at the end show how far each run strays from the uniform small steps.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+struct Result {
+	double ms;		// Time per unit simulated.
+	double active;	// Share of Joints whose forces were evaluated, per update.
+	size_t remaining;
+	double radius;	// Mass-weighted RMS distance from the centre of mass.
+};
+
+static Result run(int count, float scale, float dt, bool multiRate) {
+	const float duration = 400;
+	Environment *env = new Environment(800 * scale, 600 * scale, Vector{0, 0});
+	env->setAllowAccelerate(false);
+	env->setAllowAttract(true);
+	env->setAllowBarnesHut(true);
+	env->setAllowBounce(false);
+	env->setAllowCollide(false);
+	env->setAllowCombine(true);
+	env->setAllowDrag(false);
+	env->setAllowMultiRate(multiRate);
+	std::mt19937 engine(42);
+	std::uniform_int_distribution<int> massDist(1, 5);
+	for (int i = 0; i < count; i++) {
+		int mass = massDist(engine);
+		float size = 0.5 * pow(mass, 0.5);
+		std::uniform_real_distribution<float> xDist(size, env->getWidth() - size);
+		std::uniform_real_distribution<float> yDist(size, env->getHeight() - size);
+		env->addJoint(xDist(engine), yDist(engine), size, mass, 0);
+	}
+	
+	Result result = {0, 0, 0, 0};
+	const int updates = duration / dt;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < updates; i++) {
+		env->update(dt);
+		result.active += (double)env->getActiveCount() / env->getJoints().size();
+		std::vector<JointHandle> absorbed;
+		for (Joint *joint : env->getJoints()) {
+			if (joint->getCollideWith()) {
+				absorbed.push_back(env->getHandle(joint->getCollideWith()));
+			}
+		}
+		for (JointHandle handle : absorbed) {
+			env->removeJoint(handle);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.ms = std::chrono::duration<double, std::milli>(end - start).count() / duration;
+	result.active /= updates;
+	
+	Span<Joint * const> joints = env->getJoints();
+	double mass = 0, cx = 0, cy = 0;
+	for (Joint *joint : joints) {
+		mass += joint->getMass();
+		cx += joint->getMass() * joint->getX();
+		cy += joint->getMass() * joint->getY();
+	}
+	cx /= mass;
+	cy /= mass;
+	for (Joint *joint : joints) {
+		result.radius += joint->getMass() * ((joint->getX() - cx) * (joint->getX() - cx) + (joint->getY() - cy) * (joint->getY() - cy));
+	}
+	result.radius = sqrt(result.radius / mass);
+	result.remaining = joints.size();
+	delete env;
+	return result;
+}
+
+int main() {
+	struct Setup {
+		int count;
+		float scale;
+	};
+	const Setup setups[] = {{500, 1}, {5000, 3.16f}};
+	
+	printf("%8s %10s %8s %12s %10s %10s %10s\n", "joints", "stepping", "dt", "ms/unit", "active", "remaining", "radius");
+	for (const Setup &setup : setups) {
+		for (int mode = 0; mode < 3; mode++) {
+			// Uniform small steps, multi-rate with the same smallest step, and uniform steps as long as its longest.
+			const bool multiRate = mode == 1;
+			const float dt = mode == 2 ? 4 : 0.25f;
+			Result result = run(setup.count, setup.scale, dt, multiRate);
+			printf("%8d %10s %8.2f %12.3f %9.1f%% %10zu %10.1f\n", setup.count, multiRate ? "multi" : "uniform", dt,
+				result.ms, 100 * result.active, result.remaining, result.radius);
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
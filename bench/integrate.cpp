@@ -0,0 +1,37 @@
+// Benchmarks the per-Joint passes of Environment::update (gravity, movement, drag and bouncing).
+// Collisions are switched off so only the streaming passes are timed.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+int main() {
+	const int counts[] = {10000, 100000, 1000000};
+	const int steps = 50;
+	
+	for (int count : counts) {
+		Environment *env = new Environment(8000, 6000, Vector{static_cast<float>(M_PI), 0.2});
+		env->setAllowCollide(false);
+		
+		// Add Joints at reproducible random positions.
+		std::mt19937 engine(42);
+		std::uniform_real_distribution<float> xDist(20, env->getWidth() - 20);
+		std::uniform_real_distribution<float> yDist(20, env->getHeight() - 20);
+		std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+		for (int i = 0; i < count; i++) {
+			env->addJoint(xDist(engine), yDist(engine), 10, 100, 2, angleDist(engine), 0.9);
+		}
+		
+		// Time the steps.
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < steps; i++) {
+			env->update();
+		}
+		auto end = std::chrono::steady_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count() / steps;
+		printf("%8d joints: %9.3f ms/step  %7.2f ns/joint\n", count, ms, ms * 1e6 / count);
+		delete env;
+	}
+	
+	return EXIT_SUCCESS;
+}
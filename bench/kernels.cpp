@@ -0,0 +1,74 @@
+// Benchmarks each batch Joint kernel: the scalar version against the one chosen for this CPU.
+#include "../include/Kernels.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Joint arrays filled with reproducible values, a fraction of them outside the boundaries.
+struct Arrays {
+	std::vector<float> x, y, vx, vy, size, drag, elasticity;
+	
+	Arrays(size_t count) : x(count), y(count), vx(count), vy(count), size(count), drag(count), elasticity(count) {
+		std::mt19937 engine(42);
+		std::uniform_real_distribution<float> position(-50, 1050);
+		std::uniform_real_distribution<float> velocity(-1, 1);
+		for (size_t i = 0; i < count; i++) {
+			x[i] = position(engine);
+			y[i] = position(engine);
+			vx[i] = velocity(engine);
+			vy[i] = velocity(engine);
+			size[i] = 10;
+			drag[i] = 0.999;
+			elasticity[i] = 0.9;
+		}
+	}
+	
+	bool operator==(const Arrays &other) const {
+		return x == other.x && y == other.y && vx == other.vx && vy == other.vy;
+	}
+};
+
+// Runs one kernel over the arrays and returns the nanoseconds per Joint.
+template <typename Run>
+double time(Arrays &arrays, int repeats, Run run) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++) {
+		run(arrays);
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / repeats / arrays.x.size();
+}
+
+// Times a kernel from both sets, checks they agree and prints the result.
+template <typename Run>
+void compare(const char *name, size_t count, int repeats, Run run) {
+	Arrays scalar(count), fast(count);
+	double scalarTime = time(scalar, repeats, [&](Arrays &a) { run(getScalarKernels(), a); });
+	double fastTime = time(fast, repeats, [&](Arrays &a) { run(getKernels(), a); });
+	printf("%-8s %8zu joints: scalar %6.3f ns/joint  %s %6.3f ns/joint  x%.2f  %s\n", name, count,
+		scalarTime, getKernels().name, fastTime, scalarTime / fastTime, scalar == fast ? "identical" : "MISMATCH");
+}
+
+int main() {
+	const size_t counts[] = {10000, 1000000};
+	for (size_t count : counts) {
+		int repeats = 100000000 / count;
+		compare("move", count, repeats, [](const Kernels &k, Arrays &a) {
+			k.move(a.x.data(), a.y.data(), a.vx.data(), a.vy.data(), 0, 0.2f, 1, a.x.size());
+		});
+		compare("drag", count, repeats, [](const Kernels &k, Arrays &a) {
+			k.drag(a.vx.data(), a.vy.data(), a.drag.data(), a.x.size());
+		});
+		compare("bounce", count, repeats, [](const Kernels &k, Arrays &a) {
+			k.bounce(a.x.data(), a.y.data(), a.vx.data(), a.vy.data(), a.size.data(), a.elasticity.data(), 1000, 1000, a.x.size());
+		});
+		compare("settle", count, repeats, [](const Kernels &k, Arrays &a) {
+			k.settle(a.vx.data(), a.vy.data(), 0.15f, a.x.size());
+		});
+	}
+	
+	return EXIT_SUCCESS;
+}
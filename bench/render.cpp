@@ -0,0 +1,72 @@
+// Benchmarks reading the Joints for drawing, as a renderer does every frame. "copies" reads them the way
+// the demos did when getJoints returned a copy of its vector, copying it twice per Joint (only run at the
+// smaller counts, as it takes time quadratic in the Joints). "getters" calls each Joint's getters through
+// the getJoints view, and "vertices" packs the buffer from getJointVertices, ready to upload as it is.
+// Reports the time per frame and a checksum of what was read, which all three agree on.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const int frames = 20;
+
+// Sums what a renderer would read, so the reads cannot be left out.
+static double readCopies(Environment *env) {
+	double sum = 0;
+	for (size_t i = 0; i < env->getJoints().size(); i++) {
+		Span<Joint * const> view = env->getJoints();
+		std::vector<Joint*> joints(view.begin(), view.end());
+		std::vector<Joint*> again(view.begin(), view.end());
+		sum += joints[i]->getX() + joints[i]->getY() + again[i]->getSize();
+	}
+	return sum;
+}
+
+static double readGetters(Environment *env) {
+	double sum = 0;
+	for (Joint *joint : env->getJoints()) {
+		sum += joint->getX() + joint->getY() + joint->getSize();
+	}
+	return sum;
+}
+
+static double readVertices(Environment *env) {
+	double sum = 0;
+	for (const JointVertex &vertex : env->getJointVertices()) {
+		sum += vertex.x + vertex.y + vertex.size;
+	}
+	return sum;
+}
+
+static void run(Environment *env, const char *name, double (*read)(Environment *)) {
+	double sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames; i++) {
+		sum += read(env);
+	}
+	auto end = std::chrono::steady_clock::now();
+	printf("%10zu %10s %14.4f %16.0f\n", env->getJoints().size(), name,
+		std::chrono::duration<double, std::milli>(end - start).count() / frames, sum / frames);
+}
+
+int main() {
+	printf("%10s %10s %14s %16s\n", "joints", "read", "ms/frame", "checksum");
+	for (int count : {1000, 10000, 100000, 1000000}) {
+		Environment *env = new Environment(4000, 4000, Vector{0, 0});
+		std::mt19937 engine(42);
+		std::uniform_real_distribution<float> position(10, 3990);
+		for (int i = 0; i < count; i++) {
+			env->addJoint(position(engine), position(engine), 2, 1);
+		}
+		env->update();
+		if (count <= 10000) {
+			run(env, "copies", readCopies);
+		}
+		run(env, "getters", readGetters);
+		run(env, "vertices", readVertices);
+		delete env;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+// Benchmarks Environment::update on a large scene with and without periodic Morton reordering.
+// Joints are added in random order, so neighbours in space start out scattered through memory.
+// On Linux the cache misses of the timed updates are counted with perf_event_open where the
+// hardware counters are available; elsewhere only times are shown.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Counts the cache misses of this process between start and stop, or reports -1 when it cannot.
+struct CacheMissCounter {
+	int fd = -1;
+	CacheMissCounter() {
+#ifdef __linux__
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.inherit = 1;
+		fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+	~CacheMissCounter() {
+#ifdef __linux__
+		if (fd >= 0) {
+			close(fd);
+		}
+#endif
+	}
+	void start() {
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	long long stop() {
+		long long count = -1;
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+				count = -1;
+			}
+		}
+#endif
+		return count;
+	}
+};
+
+int main() {
+	const int count = 200000;
+	const BroadPhase broadPhases[] = {BroadPhase::QuadTree, BroadPhase::Grid};
+	const char *names[] = {"quadtree", "grid"};
+	const unsigned intervals[] = {0, 20};
+	const int warmSteps = 40;
+	const int steps = 40;
+	
+	printf("%10s %10s %12s %16s\n", "phase", "reorder", "ms/step", "misses/step");
+	for (int b = 0; b < 2; b++) {
+		for (unsigned interval : intervals) {
+			// The counter is opened before the Environment starts its workers, which then inherit it.
+			CacheMissCounter counter;
+			Environment *env = new Environment(6000, 6000, Vector{0, 0}, broadPhases[b]);
+			env->setAllowAccelerate(false);
+			env->setReorderInterval(interval);
+			std::mt19937 engine(42);
+			std::uniform_real_distribution<float> xDist(10, env->getWidth() - 10);
+			std::uniform_real_distribution<float> yDist(10, env->getHeight() - 10);
+			std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+			for (int i = 0; i < count; i++) {
+				env->addJoint(xDist(engine), yDist(engine), 4, 100, 1, angleDist(engine), 1);
+			}
+			for (int i = 0; i < warmSteps; i++) {
+				env->update();
+			}
+			
+			counter.start();
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < steps; i++) {
+				env->update();
+			}
+			auto end = std::chrono::steady_clock::now();
+			long long misses = counter.stop();
+			char missText[32] = "n/a";
+			if (misses >= 0) {
+				snprintf(missText, sizeof(missText), "%lld", misses / steps);
+			}
+			printf("%10s %10u %12.3f %16s\n", names[b], interval,
+				std::chrono::duration<double, std::milli>(end - start).count() / steps, missText);
+			delete env;
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+// Benchmarks Environment::update on a mostly-settled scene with several QuadTree margins.
+// Joints are spread out at rest without gravity. Every step a few more are set moving, so by the
+// end a tenth of them move while the rest stay below the Stable threshold.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+int main() {
+	const int count = 20000;
+	const float margins[] = {0, 1, 2, 5};
+	const int settleSteps = 300;
+	const int steps = 50;
+	
+	printf("%8s %12s\n", "margin", "ms/step");
+	for (float margin : margins) {
+		Environment *env = new Environment(3000, 3000, Vector{0, 0});
+		env->setTreeMargin(margin);
+		std::mt19937 engine(42);
+		std::uniform_real_distribution<float> xDist(10, env->getWidth() - 10);
+		std::uniform_real_distribution<float> yDist(10, env->getHeight() - 10);
+		std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+		env->setAllowAccelerate(false);
+		for (int i = 0; i < count; i++) {
+			env->addJoint(xDist(engine), yDist(engine), 5, 100, 0, 0, 0.5);
+		}
+		for (int i = 0; i < settleSteps; i++) {
+			env->update();
+		}
+		
+		// A copy, as updates may reorder the Joints.
+		Span<Joint * const> all = env->getJoints();
+		std::vector<Joint*> joints(all.begin(), all.end());
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < steps; i++) {
+			for (size_t j = i; j < joints.size(); j += 500) {
+				joints[j]->setSpeed(1);
+				joints[j]->setAngle(angleDist(engine));
+			}
+			env->update();
+		}
+		auto end = std::chrono::steady_clock::now();
+		printf("%8.1f %12.3f\n", margin, std::chrono::duration<double, std::milli>(end - start).count() / steps);
+		delete env;
+	}
+	
+	return EXIT_SUCCESS;
+}
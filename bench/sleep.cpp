@@ -0,0 +1,60 @@
+// Benchmarks Environment::update on a pile-up scene with and without sleeping.
+// Joints fall under gravity into a pile on the floor. Once it has settled, the pile is first left
+// alone, then one Joint is dropped back in from the top every 50 steps. The pile is a single island
+// of touching Joints, so each landing wakes all of it until it settles again.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+int main() {
+	const int counts[] = {5000, 20000};
+	const int settleSteps = 2000;
+	const int steps = 500;
+	
+	printf("%8s %8s %12s %12s %10s\n", "joints", "sleep", "rest ms", "drop ms", "awake");
+	for (int count : counts) {
+		for (bool sleep : {false, true}) {
+			Environment *env = new Environment(2000, 1500, Vector{static_cast<float>(M_PI), 0.2});
+			env->setAllowSleep(sleep);
+			std::mt19937 engine(42);
+			std::uniform_real_distribution<float> xDist(10, env->getWidth() - 10);
+			std::uniform_real_distribution<float> yDist(10, env->getHeight() - 10);
+			for (int i = 0; i < count; i++) {
+				env->addJoint(xDist(engine), yDist(engine), 5, 100, 0, 0, 0.3);
+			}
+			for (int i = 0; i < settleSteps; i++) {
+				env->update();
+			}
+			
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < steps; i++) {
+				env->update();
+			}
+			auto end = std::chrono::steady_clock::now();
+			double rest = std::chrono::duration<double, std::milli>(end - start).count() / steps;
+			
+			// A copy, as updates may reorder the Joints.
+			Span<Joint * const> all = env->getJoints();
+			std::vector<Joint*> joints(all.begin(), all.end());
+			size_t awake = 0;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < steps; i++) {
+				if (i % 50 == 0) {
+					Joint *joint = joints[(i * 7919) % joints.size()];
+					joint->setX(xDist(engine));
+					joint->setY(10);
+					joint->setVelocity(0, 0);
+				}
+				env->update();
+				awake += env->getAwakeCount();
+			}
+			end = std::chrono::steady_clock::now();
+			double drop = std::chrono::duration<double, std::milli>(end - start).count() / steps;
+			printf("%8d %8s %12.3f %12.3f %10zu\n", count, sleep ? "on" : "off", rest, drop, awake / steps);
+			delete env;
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+// Benchmarks reading the Joints from other threads while the Environment updates. With setAllowSnapshots,
+// each update ends by publishing a Snapshot of the Joints' positions; reader threads hold the latest with
+// getSnapshot and never block the update, nor it them. The Joints fly in straight lines, so the readers
+// can check every Snapshot they read against where each Joint must be at that update: a Snapshot mixing
+// two updates counts as torn. Reports the time per update, the Snapshots published and dropped, the
+// Snapshots read, and the torn ones.
+#include "../include/cpparticles.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const int joints = 100000;
+static const int steps = 300;
+
+struct Start {
+	std::vector<float> x, y, vx, vy;
+};
+
+// Reads Snapshots until told to stop, counting those read and those not matching a single update.
+static void read(Environment *env, const Start &start, const std::atomic<bool> &stop, size_t &reads, size_t &torn) {
+	uint64_t last = 0;
+	while (!stop) {
+		SnapshotBuffer::Lease snapshot = env->getSnapshot();
+		if (!snapshot || snapshot->update == last) {
+			std::this_thread::yield();
+			continue;
+		}
+		last = snapshot->update;
+		bool whole = snapshot->joints.size() == joints;
+		for (size_t i = 0; whole && i < snapshot->joints.size(); i++) {
+			uint32_t id = snapshot->ids[i];
+			float x = start.x[id] + start.vx[id] * snapshot->update;
+			float y = start.y[id] + start.vy[id] * snapshot->update;
+			whole = hypot(snapshot->joints[i].x - x, snapshot->joints[i].y - y) < 1;
+		}
+		reads++;
+		torn += !whole;
+	}
+}
+
+static void run(bool snapshots, int readers) {
+	Environment *env = new Environment(20000, 20000, Vector{0, 0});
+	env->setAllowAccelerate(false);
+	env->setAllowDrag(false);
+	env->setAllowCollide(false);
+	env->setAllowSnapshots(snapshots);
+	env->getSnapshots().setReaders(std::max(readers, 1));
+	std::mt19937 engine(42);
+	std::uniform_real_distribution<float> position(5000, 15000);
+	std::uniform_real_distribution<float> speed(5, 10);
+	std::uniform_real_distribution<float> angle(0, 2 * M_PI);
+	Start start;
+	for (int i = 0; i < joints; i++) {
+		Joint *joint = env->addJoint(position(engine), position(engine), 2, 1, speed(engine), angle(engine), 1);
+		start.x.push_back(joint->getX());
+		start.y.push_back(joint->getY());
+		start.vx.push_back(joint->getVelocityX());
+		start.vy.push_back(joint->getVelocityY());
+	}
+
+	std::atomic<bool> stop(false);
+	std::vector<size_t> reads(readers), torn(readers);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < readers; i++) {
+		threads.emplace_back(read, env, std::cref(start), std::cref(stop), std::ref(reads[i]), std::ref(torn[i]));
+	}
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < steps; i++) {
+		env->update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	stop = true;
+	size_t totalReads = 0, totalTorn = 0;
+	for (int i = 0; i < readers; i++) {
+		threads[i].join();
+		totalReads += reads[i];
+		totalTorn += torn[i];
+	}
+	printf("%10s %8d %12.3f %10zu %10zu %10zu %8zu\n", snapshots ? "on" : "off", readers,
+		std::chrono::duration<double, std::milli>(end - begin).count() / steps,
+		env->getSnapshots().getPublished(), env->getSnapshots().getDropped(), totalReads, totalTorn);
+	delete env;
+}
+
+int main() {
+	printf("%10s %8s %12s %10s %10s %10s %8s\n", "snapshots", "readers", "ms/update", "published", "dropped", "read", "torn");
+	run(false, 0);
+	for (int readers : {0, 1, 2, 4}) {
+		run(true, readers);
+	}
+
+	return EXIT_SUCCESS;
+}
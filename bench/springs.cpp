@@ -0,0 +1,69 @@
+// Benchmarks the spring solvers on a jelly block: a square lattice of Joints joined to their
+// neighbours along the sides and diagonals, dropped onto the floor under gravity. Collisions are
+// off, so the time is that of the springs. The largest speed at the end shows whether the solver
+// stayed stable with stiff springs; a solver that blew up reports nan.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+
+int main() {
+	const int side = 180;
+	const float spacing = 8;
+	const float strength = 50;
+	const int steps = 100;
+	struct Setup {
+		const char *name;
+		SpringSolver solver;
+		unsigned iterations;
+	};
+	const Setup setups[] = {{"force", SpringSolver::Force, 1}, {"xpbd x4", SpringSolver::XPBD, 4}, {"xpbd x8", SpringSolver::XPBD, 8}};
+	
+	printf("%10s %10s %12s %14s\n", "solver", "springs", "ms/step", "max speed");
+	for (const Setup &setup : setups) {
+		Environment *env = new Environment(2000, 2000, Vector{static_cast<float>(M_PI), 0.2});
+		env->setAllowCollide(false);
+		env->setSpringSolver(setup.solver);
+		env->setSpringIterations(setup.iterations);
+		std::vector<Joint*> lattice;
+		for (int row = 0; row < side; row++) {
+			for (int column = 0; column < side; column++) {
+				lattice.push_back(env->addJoint(280 + column * spacing, 200 + row * spacing, 3, 100, 0, 0, 0.5));
+			}
+		}
+		for (int row = 0; row < side; row++) {
+			for (int column = 0; column < side; column++) {
+				Joint *joint = lattice[row * side + column];
+				if (column + 1 < side) {
+					env->addSpring(joint, lattice[row * side + column + 1], spacing, strength);
+				}
+				if (row + 1 < side) {
+					env->addSpring(joint, lattice[(row + 1) * side + column], spacing, strength);
+				}
+				if (column + 1 < side && row + 1 < side) {
+					env->addSpring(joint, lattice[(row + 1) * side + column + 1], spacing * M_SQRT2, strength);
+				}
+				if (column > 0 && row + 1 < side) {
+					env->addSpring(joint, lattice[(row + 1) * side + column - 1], spacing * M_SQRT2, strength);
+				}
+			}
+		}
+		
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < steps; i++) {
+			env->update();
+		}
+		auto end = std::chrono::steady_clock::now();
+		float maxSpeed = 0;
+		for (Joint *joint : lattice) {
+			// Written so that a nan speed carries through.
+			if (!(joint->getSpeed() <= maxSpeed)) {
+				maxSpeed = joint->getSpeed();
+			}
+		}
+		printf("%10s %10zu %12.3f %14.3f\n", setup.name, env->getSprings().size(),
+			std::chrono::duration<double, std::milli>(end - start).count() / steps, maxSpeed);
+		delete env;
+	}
+	
+	return EXIT_SUCCESS;
+}
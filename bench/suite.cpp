@@ -0,0 +1,316 @@
+// Headless benchmark suite. Recreates the demo scenarios (collisions, gas_cloud, soft_body) and a few
+// heavier ones (dense_pile, line_maze, spring_mesh) at 100 to 1,000,000 Joints, and prints the results
+// as JSON for tracking across versions:
+//   suite [--scenario name] [--min joints] [--max joints] [--steps count] [--workers count] [--trace prefix]
+// Each run takes a couple of warm-up updates and then times updates until it has --steps of them or a
+// second has passed, whichever comes first (at least 3). Each result gives the time per update, the
+// mean time and counters of every Environment phase and the Joint updates per second. With --trace, each
+// run's timed updates are also written to <prefix><scenario>_<joints>.json for chrome://tracing.
+// Progress goes to stderr.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+struct Options {
+	std::string scenario;
+	size_t minJoints = 100;
+	size_t maxJoints = 1000000;
+	int steps = 50;
+	int workers = 0;
+	std::string trace;
+};
+
+struct Scenario {
+	const char *name;
+	Environment *(*build)(size_t joints);
+	bool removeCombined;	// Whether Joints absorbed by others are removed after each update, as in gas_cloud.
+};
+
+// collisions: random Joints of the demo's sizes, masses and speeds under gravity, at the demo's density
+// of one Joint per 800 x 600 / 10.
+static Environment *buildCollisions(size_t joints) {
+	float scale = sqrt(joints / 10.0);
+	Environment *env = new Environment(800 * scale, 600 * scale, Vector{M_PI, 0.2});
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<float> sizeDist(10, 20);
+	std::uniform_real_distribution<float> massDist(100, 10000);
+	std::uniform_real_distribution<float> speedDist(0, 1);
+	std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+	std::uniform_real_distribution<float> elasticityDist(0.8, 1);
+	for (size_t i = 0; i < joints; i++) {
+		float size = sizeDist(engine);
+		std::uniform_real_distribution<float> xDist(size, env->getWidth() - size);
+		std::uniform_real_distribution<float> yDist(size, env->getHeight() - size);
+		env->addJoint(xDist(engine), yDist(engine), size, massDist(engine), speedDist(engine), angleDist(engine), elasticityDist(engine));
+	}
+	return env;
+}
+
+
+// gas_cloud: the demo's Joints of mass 1 to 5 at rest, pulled together by Barnes-Hut attraction and
+// combining on contact, at its density of 500 Joints per 800 x 600.
+static Environment *buildGasCloud(size_t joints) {
+	float scale = sqrt(joints / 500.0);
+	Environment *env = new Environment(800 * scale, 600 * scale, Vector{0, 0});
+	env->setAllowAccelerate(false);
+	env->setAllowAttract(true);
+	env->setAllowBarnesHut(true);
+	env->setAllowBounce(false);
+	env->setAllowCollide(false);
+	env->setAllowCombine(true);
+	env->setAllowDrag(false);
+	std::mt19937 engine(2);
+	std::uniform_int_distribution<int> massDist(1, 5);
+	for (size_t i = 0; i < joints; i++) {
+		int mass = massDist(engine);
+		float size = 0.5 * pow(mass, 0.5);
+		std::uniform_real_distribution<float> xDist(size, env->getWidth() - size);
+		std::uniform_real_distribution<float> yDist(size, env->getHeight() - size);
+		env->addJoint(xDist(engine), yDist(engine), size, mass, 0);
+	}
+	return env;
+}
+
+
+// soft_body: copies of the demo's square of four Joints and six springs, one per 300 x 300 cell,
+// falling under gravity.
+static Environment *buildSoftBody(size_t joints) {
+	size_t bodies = std::max<size_t>(joints / 4, 1);
+	size_t columns = ceil(sqrt(bodies));
+	size_t rows = (bodies + columns - 1) / columns;
+	Environment *env = new Environment(columns * 300 + 100, rows * 300 + 300, Vector{M_PI, 0.2});
+	for (size_t i = 0; i < bodies; i++) {
+		float left = 50 + (i % columns) * 300;
+		float top = 50 + (i / columns) * 300;
+		Joint *p1 = env->addJoint(left, top, 10, 600, 0, 0, 0.1);
+		Joint *p2 = env->addJoint(left + 200, top, 10, 600, 0, 0, 0.1);
+		Joint *p3 = env->addJoint(left + 200, top + 200, 10, 600, 0, 0, 0.1);
+		Joint *p4 = env->addJoint(left, top + 200, 10, 600, 0, 0, 0.1);
+		env->addSpring(p1, p2, 200, 50);
+		env->addSpring(p2, p3, 200, 50);
+		env->addSpring(p3, p4, 200, 50);
+		env->addSpring(p4, p1, 200, 50);
+		env->addSpring(p1, p3, 200, 50);
+		env->addSpring(p2, p4, 200, 50);
+	}
+	return env;
+}
+
+
+// dense_pile: rows of touching Joints filling the lower half of a box, settling under gravity with the
+// warm-started impulse solver.
+static Environment *buildDensePile(size_t joints) {
+	const float size = 5;
+	size_t columns = ceil(sqrt(joints * 2.0));
+	size_t rows = (joints + columns - 1) / columns;
+	Environment *env = new Environment(columns * size * 2 + size, rows * size * 4, Vector{M_PI, 0.2});
+	env->setContactSolver(ContactSolver::Impulse);
+	for (size_t i = 0; i < joints; i++) {
+		size_t row = i / columns;
+		float x = size + (i % columns) * size * 2 + (row % 2) * size * 0.5f;
+		float y = env->getHeight() - size - row * size * 2;
+		env->addJoint(x, y, size, 10, 0, 0, 0.5);
+	}
+	return env;
+}
+
+
+// line_maze: Joints moving fast through a grid of 60 x 60 cells whose edges are thin Lines with
+// probability 0.3, swept against them so none pass through. There are about four Joints per cell.
+static Environment *buildLineMaze(size_t joints) {
+	const float cell = 60;
+	size_t cells = ceil(sqrt(std::max<size_t>(joints / 4, 1)));
+	Environment *env = new Environment(cells * cell, cells * cell, Vector{0, 0});
+	env->setAllowAccelerate(false);
+	env->setAllowDrag(false);
+	env->setAllowContinuousCollide(true);
+	std::mt19937 engine(3);
+	std::uniform_real_distribution<float> chance(0, 1);
+	for (size_t row = 0; row < cells; row++) {
+		for (size_t column = 0; column < cells; column++) {
+			float x = column * cell, y = row * cell;
+			if (column > 0 && chance(engine) < 0.3) {
+				env->addLine(x, y, x, y + cell, 1);
+			}
+			if (row > 0 && chance(engine) < 0.3) {
+				env->addLine(x, y, x + cell, y, 1);
+			}
+		}
+	}
+	std::uniform_real_distribution<float> offset(8, cell - 8);
+	std::uniform_real_distribution<float> speedDist(2, 10);
+	std::uniform_real_distribution<float> angleDist(0, 2 * M_PI);
+	for (size_t i = 0; i < joints; i++) {
+		size_t c = i / 4 % (cells * cells);
+		env->addJoint((c % cells) * cell + offset(engine), (c / cells) * cell + offset(engine), 3, 1, speedDist(engine), angleDist(engine), 1);
+	}
+	return env;
+}
+
+
+// spring_mesh: a square lattice of Joints 20 apart, each joined to its right, lower and lower-right
+// neighbours by stiff springs solved with XPBD, falling onto the floor.
+static Environment *buildSpringMesh(size_t joints) {
+	const float spacing = 20;
+	size_t side = ceil(sqrt(joints));
+	Environment *env = new Environment(side * spacing + 100, side * spacing * 2 + 100, Vector{M_PI, 0.2});
+	env->setSpringSolver(SpringSolver::XPBD);
+	std::vector<Joint*> lattice;
+	for (size_t i = 0; i < joints; i++) {
+		lattice.push_back(env->addJoint(50 + (i % side) * spacing, 50 + (i / side) * spacing, 4, 10, 0, 0, 0.5));
+	}
+	for (size_t i = 0; i < joints; i++) {
+		bool right = i % side + 1 < side && i + 1 < joints;
+		bool down = i + side < joints;
+		if (right) {
+			env->addSpring(lattice[i], lattice[i + 1], spacing, 1000);
+		}
+		if (down) {
+			env->addSpring(lattice[i], lattice[i + side], spacing, 1000);
+		}
+		if (right && i + side + 1 < joints) {
+			env->addSpring(lattice[i], lattice[i + side + 1], spacing * sqrt(2), 1000);
+		}
+	}
+	return env;
+}
+
+
+static const Scenario Scenarios[] = {
+	{"collisions", buildCollisions, false},
+	{"gas_cloud", buildGasCloud, true},
+	{"soft_body", buildSoftBody, false},
+	{"dense_pile", buildDensePile, false},
+	{"line_maze", buildLineMaze, false},
+	{"spring_mesh", buildSpringMesh, false},
+};
+
+
+// Removes the Joints absorbed by others in the last update.
+static void removeCombined(Environment *env) {
+	std::vector<JointHandle> absorbed;
+	for (Joint *joint : env->getJoints()) {
+		if (joint->getCollideWith()) {
+			absorbed.push_back(env->getHandle(joint->getCollideWith()));
+		}
+	}
+	for (JointHandle handle : absorbed) {
+		env->removeJoint(handle);
+	}
+}
+
+
+// Runs one scenario at one size and prints its result as a JSON object.
+static void run(const Scenario &scenario, size_t joints, const Options &options, bool first) {
+	fprintf(stderr, "%s %zu...\n", scenario.name, joints);
+	auto buildStart = std::chrono::steady_clock::now();
+	Environment *env = scenario.build(joints);
+	double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+	if (options.workers > 0) {
+		env->setWorkerCount(options.workers);
+	}
+	env->setAllowInstrument(true);
+	for (int i = 0; i < 2; i++) {
+		env->update();
+		if (scenario.removeCombined) {
+			removeCombined(env);
+		}
+	}
+
+	std::vector<double> stepTimes;
+	double phases[(int)Phase::Count] = {};
+	double counters[(int)Counter::Count] = {};
+	double elapsed = 0;
+	env->setAllowTrace(!options.trace.empty());
+	size_t jointUpdates = 0;
+	while ((int)stepTimes.size() < 3 || ((int)stepTimes.size() < options.steps && elapsed < 1000)) {
+		jointUpdates += env->getJoints().size();
+		auto start = std::chrono::steady_clock::now();
+		env->update();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		stepTimes.push_back(ms);
+		elapsed += ms;
+		for (int phase = 0; phase < (int)Phase::Count; phase++) {
+			phases[phase] += env->getPhaseTime((Phase)phase);
+		}
+		for (int counter = 0; counter < (int)Counter::Count; counter++) {
+			counters[counter] += env->getCounter((Counter)counter);
+		}
+		if (scenario.removeCombined) {
+			removeCombined(env);
+		}
+	}
+	std::vector<double> sorted = stepTimes;
+	std::sort(sorted.begin(), sorted.end());
+	const size_t steps = stepTimes.size();
+
+	printf("%s\n    {\"scenario\": \"%s\", \"joints\": %zu, \"springs\": %zu, \"lines\": %zu, \"steps\": %zu, \"build_ms\": %.3f,\n",
+		first ? "" : ",", scenario.name, joints, env->getSprings().size(), env->getLines().size(), steps, buildMs);
+	printf("     \"step_ms\": {\"mean\": %.4f, \"min\": %.4f, \"median\": %.4f, \"max\": %.4f},\n",
+		elapsed / steps, sorted.front(), sorted[steps / 2], sorted.back());
+	printf("     \"phase_ms\": {");
+	for (int phase = 0; phase < (int)Phase::Count; phase++) {
+		printf("%s\"%s\": %.4f", phase ? ", " : "", Environment::getPhaseName((Phase)phase), phases[phase] / steps);
+	}
+	printf("},\n     \"counters\": {");
+	for (int counter = 0; counter < (int)Counter::Count; counter++) {
+		printf("%s\"%s\": %.1f", counter ? ", " : "", Environment::getCounterName((Counter)counter), counters[counter] / steps);
+	}
+	printf("},\n     \"joint_updates_per_second\": %.0f, \"joints_remaining\": %zu}", jointUpdates / (elapsed / 1000), env->getJoints().size());
+	fflush(stdout);
+	if (!options.trace.empty()) {
+		std::string path = options.trace + scenario.name + "_" + std::to_string(joints) + ".json";
+		if (!env->writeTrace(path)) {
+			fprintf(stderr, "Could not write %s\n", path.c_str());
+		}
+	}
+	delete env;
+}
+
+
+int main(int argc, char **argv) {
+	Options options;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--scenario")) {
+			options.scenario = argv[i + 1];
+		} else if (!strcmp(argv[i], "--min")) {
+			options.minJoints = strtoull(argv[i + 1], nullptr, 10);
+		} else if (!strcmp(argv[i], "--max")) {
+			options.maxJoints = strtoull(argv[i + 1], nullptr, 10);
+		} else if (!strcmp(argv[i], "--steps")) {
+			options.steps = atoi(argv[i + 1]);
+		} else if (!strcmp(argv[i], "--workers")) {
+			options.workers = atoi(argv[i + 1]);
+		} else if (!strcmp(argv[i], "--trace")) {
+			options.trace = argv[i + 1];
+		} else {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	Environment probe(100, 100, Vector{0, 0});
+	if (options.workers > 0) {
+		probe.setWorkerCount(options.workers);
+	}
+	printf("{\"suite\": \"cpparticles\", \"workers\": %u, \"results\": [", probe.getWorkerCount());
+	bool first = true;
+	for (const Scenario &scenario : Scenarios) {
+		if (!options.scenario.empty() && options.scenario != scenario.name) {
+			continue;
+		}
+		for (size_t joints = 100; joints <= 1000000; joints *= 10) {
+			if (joints < options.minJoints || joints > options.maxJoints) {
+				continue;
+			}
+			run(scenario, joints, options, first);
+			first = false;
+		}
+	}
+	printf("\n]}\n");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+// Benchmarks the integrators at several step sizes on a field of independent spinning spring pairs.
+// They spin so that no Joint slows below the Stable threshold, where its velocity would be zeroed.
+// Every run covers the same simulated time through Environment::step. The position error is the RMS
+// distance of the Joints from a run of velocity Verlet with very small steps. The energy error compares
+// the final energy with the starting one; it shows how well the velocities keep up with the positions.
+// The time is per unit simulated.
+#include "../include/cpparticles.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+static const int pairs = 20000;
+static const float duration = 200;
+static const float length = 6;
+static const float strength = 5;
+
+// Returns the kinetic energy of the Joints plus the energy stored in the springs. Spring::update pushes
+// with (2 * length - separation) * strength, so that is the force the stored energy follows.
+static double getEnergy(Environment *env) {
+	double energy = 0;
+	for (Joint *joint : env->getJoints()) {
+		energy += 0.5 * joint->getMass() * joint->getSpeed() * joint->getSpeed();
+	}
+	for (Spring *spring : env->getSprings()) {
+		double separation = hypot(spring->getP1()->getX() - spring->getP2()->getX(), spring->getP1()->getY() - spring->getP2()->getY());
+		energy += 0.5 * strength * (separation - 2 * length) * (separation - 2 * length);
+	}
+	return energy;
+}
+
+// Runs the scene and returns the final Joint positions; ms receives the time per unit simulated
+// and drift the relative change in energy.
+static std::vector<float> run(Integrator integrator, float dt, double &ms, double &drift) {
+	Environment *env = new Environment(4000, 4000, Vector{0, 0});
+	env->setAllowAccelerate(false);
+	env->setAllowBounce(false);
+	env->setAllowCollide(false);
+	env->setAllowDrag(false);
+	env->setIntegrator(integrator);
+	env->setTimeStep(dt);
+	env->setMaxSteps(static_cast<unsigned>(duration / dt) + 1);
+	for (int i = 0; i < pairs; i++) {
+		float x = 20 + (i % 140) * 28;
+		float y = 20 + (i / 140) * 28;
+		Joint *first = env->addJoint(x, y, 2, 100, 1, 0, 1);
+		Joint *second = env->addJoint(x + 10, y, 2, 100, 1, M_PI, 1);
+		env->addSpring(first, second, length, strength);
+	}
+	
+	double energy = getEnergy(env);
+	auto start = std::chrono::steady_clock::now();
+	env->step(duration);
+	auto end = std::chrono::steady_clock::now();
+	ms = std::chrono::duration<double, std::milli>(end - start).count() / duration;
+	drift = fabs(getEnergy(env) - energy) / energy;
+	std::vector<float> positions;
+	for (Joint *joint : env->getJoints()) {
+		positions.push_back(joint->getX());
+		positions.push_back(joint->getY());
+	}
+	delete env;
+	return positions;
+}
+
+int main() {
+	struct Setup {
+		const char *name;
+		Integrator integrator;
+		float dt;
+	};
+	const Setup setups[] = {
+		{"euler", Integrator::SemiImplicitEuler, 0.25}, {"euler", Integrator::SemiImplicitEuler, 0.5},
+		{"euler", Integrator::SemiImplicitEuler, 1}, {"euler", Integrator::SemiImplicitEuler, 2},
+		{"verlet", Integrator::VelocityVerlet, 0.5}, {"verlet", Integrator::VelocityVerlet, 1},
+		{"verlet", Integrator::VelocityVerlet, 2}, {"verlet", Integrator::VelocityVerlet, 4}};
+	
+	double ms, drift;
+	std::vector<float> reference = run(Integrator::VelocityVerlet, 1.0f / 32, ms, drift);
+	printf("%10s %8s %14s %16s %14s\n", "integrator", "dt", "ms/unit", "position error", "energy error");
+	for (const Setup &setup : setups) {
+		std::vector<float> positions = run(setup.integrator, setup.dt, ms, drift);
+		double error = 0;
+		for (size_t i = 0; i < positions.size(); i++) {
+			error += (positions[i] - reference[i]) * (positions[i] - reference[i]);
+		}
+		printf("%10s %8.2f %14.3f %16.4f %14.4f\n", setup.name, setup.dt, ms, sqrt(error / pairs / 2), drift);
+	}
+	
+	return EXIT_SUCCESS;
+}
@@ -5,7 +5,7 @@
 int main() {
 	
 	// Set up the environment.
-	Environment *env = new Environment(800, 600);
+	Environment *env = new Environment(800, 600, Vector{M_PI, 0.2});
 	Joint *selectedJoint = nullptr;
 	
 	// Create the main window.
@@ -65,12 +65,11 @@ int main() {
 			selectedJoint->moveTo(mouseX, mouseY);
 		}
 		
-		// Draw Joints.
-		for (int i = 0; i < env->getJoints().size(); i++) {
-			Joint *Joint = env->getJoints()[i];
-			sf::CircleShape circle(Joint->getSize());
-			circle.setOrigin(Joint->getSize(), Joint->getSize());
-			circle.setPosition(Joint->getX(), Joint->getY());
+		// Draw Joints from the packed position and size buffer.
+		for (const JointVertex &vertex : env->getJointVertices()) {
+			sf::CircleShape circle(vertex.size);
+			circle.setOrigin(vertex.size, vertex.size);
+			circle.setPosition(vertex.x, vertex.y);
 			window.draw(circle);
 		}
 		
@@ -3,15 +3,17 @@
 
 #include <math.h>
 #include <random>
+#include <vector>
 #include <SFML/Graphics.hpp>
 #include "../include/cpparticles.hpp"
 
 int main() {
 	
 	// Set up the environment.
-	Environment *env = new Environment(800, 600);
+	Environment *env = new Environment(800, 600, Vector{0, 0});
 	env->setAllowAccelerate(false);
 	env->setAllowAttract(true);
+	env->setAllowBarnesHut(true);
 	env->setAllowBounce(false);
 	env->setAllowCollide(false);
 	env->setAllowCombine(true);
@@ -39,7 +41,7 @@ int main() {
 		float size = 0.5 * pow(mass, 0.5);
 		std::uniform_int_distribution<int> xDist(size, env->getWidth() - size);
 		std::uniform_int_distribution<int> yDist(size, env->getHeight() - size);
-		env->addParticle(xDist(rd), yDist(rd), size, mass, 0);
+		env->addJoint(xDist(rd), yDist(rd), size, mass, 0);
 	}
 	
 	while (window.isOpen()) {
@@ -121,21 +123,23 @@ int main() {
 			env->update();
 		}
 		
-		for (int i = 0; i < env->getJoint().size(); i++) {
-			Particle *particle = env->getJoint()[i];
-			
-			// Combine colliding Joint.
-			if (particle->getCollideWith()) {
-				env->removeParticle(particle->getCollideWith());
-				particle->setSize(0.5 * pow(particle->getMass(), 0.5));
+		// Combine colliding Joints: each grows to its new mass and the Joint it absorbed is removed.
+		std::vector<JointHandle> absorbed;
+		for (Joint *joint : env->getJoints()) {
+			if (joint->getCollideWith()) {
+				absorbed.push_back(env->getHandle(joint->getCollideWith()));
+				joint->setSize(0.5 * pow(joint->getMass(), 0.5));
 			}
-			
-			// Update view window by changing the position and size of the drawn Joint.
-			float x = mx + (dx + particle->getX()) * magnification;
-			float y = my + (dy + particle->getY()) * magnification;
-			float size = particle->getSize() * magnification;
-			
-			// Draw Joint.
+		}
+		for (JointHandle handle : absorbed) {
+			env->removeJoint(handle);
+		}
+		
+		// Draw Joints from the packed position and size buffer, moved and scaled to the view window.
+		for (const JointVertex &vertex : env->getJointVertices()) {
+			float x = mx + (dx + vertex.x) * magnification;
+			float y = my + (dy + vertex.y) * magnification;
+			float size = vertex.size * magnification;
 			sf::CircleShape circle(size);
 			circle.setOrigin(size, size);
 			circle.setPosition(x, y);
@@ -5,8 +5,8 @@
 int main() {
 	
 	// Set up the environment.
-	Environment *env = new Environment(800, 600);
-	Particle *selectedParticle = nullptr;
+	Environment *env = new Environment(800, 600, Vector{M_PI, 0.2});
+	Joint *selectedJoint = nullptr;
 	
 	// Create the main window.
 	sf::RenderWindow window(sf::VideoMode(env->getWidth(), env->getHeight()), "Soft Body Simulation");
@@ -19,10 +19,10 @@ int main() {
 	int angle = 0;
 	float elasticity = 0.1;
 	
-	Particle *p1 = env->addParticle(300, 300, size, mass, speed, angle, elasticity);
-	Particle *p2 = env->addParticle(500, 300, size, mass, speed, angle, elasticity);
-	Particle *p3 = env->addParticle(500, 500, size, mass, speed, angle, elasticity);
-	Particle *p4 = env->addParticle(300, 500, size, mass, speed, angle, elasticity);
+	Joint *p1 = env->addJoint(300, 300, size, mass, speed, angle, elasticity);
+	Joint *p2 = env->addJoint(500, 300, size, mass, speed, angle, elasticity);
+	Joint *p3 = env->addJoint(500, 500, size, mass, speed, angle, elasticity);
+	Joint *p4 = env->addJoint(300, 500, size, mass, speed, angle, elasticity);
 	
 	// Connect Joint using springs to create the soft body.
 	int length = 200;
@@ -53,18 +53,18 @@ int main() {
 				}
 			}
 			
-			// Left mouse button: select particle.
+			// Left mouse button: select a Joint.
 			if (event.type == sf::Event::MouseButtonPressed) {
 				if (event.mouseButton.button == sf::Mouse::Left) {
 					float mouseX = event.mouseButton.x;
 					float mouseY = event.mouseButton.y;
-					selectedParticle = env->getParticle(mouseX, mouseY);
+					selectedJoint = env->getJoint(mouseX, mouseY);
 				}
 			}
 			
 			if (event.type == sf::Event::MouseButtonReleased) {
 				if (event.mouseButton.button == sf::Mouse::Left) {
-					selectedParticle = nullptr;
+					selectedJoint = nullptr;
 				}
 			}
 		}
@@ -75,20 +75,20 @@ int main() {
 		// Update the environment.
 		env->update();
 		
-		// Move the selected particle to the cursor's position.
-		if (selectedParticle) {
+		// Move the selected Joint to the cursor's position.
+		if (selectedJoint) {
 			float mouseX = sf::Mouse::getPosition(window).x;
 			float mouseY = sf::Mouse::getPosition(window).y;
-			selectedParticle->moveTo(mouseX, mouseY);
+			selectedJoint->moveTo(mouseX, mouseY);
 		}
 		
-		// Draw springs.
-		for (int i=0; i<env->getSprings().size(); i++) {
-			Spring *spring = env->getSprings()[i];
+		// Draw springs between the ends' positions in the packed buffer.
+		Span<const JointVertex> vertices = env->getJointVertices();
+		for (const std::pair<uint32_t, uint32_t> &ends : env->getSpringEnds()) {
 			sf::Vertex line[] =
 			{
-				sf::Vertex(sf::Vector2f(spring->getP1()->getX(), spring->getP1()->getY())),
-				sf::Vertex(sf::Vector2f(spring->getP2()->getX(), spring->getP2()->getY()))
+				sf::Vertex(sf::Vector2f(vertices[ends.first].x, vertices[ends.first].y)),
+				sf::Vertex(sf::Vector2f(vertices[ends.second].x, vertices[ends.second].y))
 			};
 			window.draw(line, 2, sf::Lines);
 		}
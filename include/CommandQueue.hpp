@@ -0,0 +1,76 @@
+// Header for the CommandQueue class.
+#ifndef CommandQueue_hpp
+#define CommandQueue_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include "Pool.hpp"
+
+class Joint;
+
+
+// A change to the Environment asked for by another thread, applied by Environment::update.
+// Joints are named by handle, so a command for a Joint removed in the meantime does nothing.
+struct Command {
+	enum Kind {
+		AddJoint,		// Adds a Joint at (x, y) of size, mass, speed, angle and elasticity.
+		RemoveJoint,	// Removes joint.
+		AddSpring,		// Ties joint to other with a spring of length and strength.
+		MoveTo,			// Moves joint towards (x, y), as Joint::moveTo.
+		Impulse			// Changes joint's velocity by impulse (x, y) over its mass.
+	};
+	Kind kind = AddJoint;
+	Handle<Joint> joint, other;
+	float x = 0, y = 0;
+	float size = 10, mass = 100, speed = 0, angle = 0, elasticity = 0.9;
+	float length = 50, strength = 0.5;
+	// Called with the new Joint's handle once AddJoint is applied, on the thread updating the Environment.
+	std::function<void(Handle<Joint>)> added;
+
+	std::atomic<Command*> next{nullptr};
+
+	Command() = default;
+	explicit Command(Kind kind) : kind(kind) {}
+};
+
+
+// Intrusive multi-producer single-consumer queue of Commands (Dmitry Vyukov's design). Any thread pushes
+// with one atomic exchange and never waits; the thread updating the Environment pops them in order.
+// A push in progress holds up the ones after it until the next drain, rather than the popping thread
+// waiting for it. Popped Commands go back through recycle and out again through make, so a queue
+// kept busy stops allocating once it has enough Commands in hand.
+class CommandQueue {
+public:
+	CommandQueue();
+	CommandQueue(const CommandQueue &) = delete;
+	CommandQueue & operator=(const CommandQueue &) = delete;
+	~CommandQueue();
+
+	Command * make(Command::Kind kind);
+	void push(Command *command);
+	Command * pop();
+	void recycle(Command *command);
+	size_t getPending() const { return pending.load(std::memory_order_relaxed); }
+
+private:
+	void link(Command *command);
+	Command * takeSpare();
+
+	Command stub;
+	std::atomic<Command*> head{&stub};	// Last pushed; producers swap themselves in here.
+	Command *tail = &stub;				// Next to pop, only touched by the consumer.
+	std::atomic<size_t> pending{0};
+
+	// Spare Commands in a bounded ring any thread may take from (Dmitry Vyukov's bounded queue). Each slot's
+	// sequence says whether it is free to fill or holds a Command, and for which lap around the ring.
+	struct Spare {
+		std::atomic<size_t> sequence;
+		Command *command = nullptr;
+	};
+	static const size_t Spares = 1024;	// A power of two; Commands recycled past it are deleted.
+	Spare spares[Spares];
+	std::atomic<size_t> spareIn{0}, spareOut{0};
+};
+
+#endif // CommandQueue_hpp
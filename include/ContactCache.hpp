@@ -0,0 +1,35 @@
+// Header for the ContactCache struct.
+#ifndef ContactCache_hpp
+#define ContactCache_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct JointStore;
+
+
+// Contacts between touching Joints for the impulse solver. The contacts of an update line up with the
+// broad phase's pairs, so they run in the same conflict-free batches. The impulse each contact ends an
+// update with is kept by the pair of Joint ids, and the contact between the same Joints in the next
+// update starts from it.
+struct ContactCache {
+	// One entry per pair of the update. Pairs that do not touch, or that hold a Line, have no mass.
+	std::vector<float> nx, ny;	// Unit normal from the second Joint towards the first.
+	std::vector<float> mass;	// Effective mass along the normal.
+	std::vector<float> bounce;	// Separating speed asked for by restitution.
+	std::vector<float> impulse;	// Impulse along the normal built up so far.
+	std::vector<uint64_t> keys;
+	// Impulses of the touching pairs by pair of Joint ids: those of the last update, sorted by key, and
+	// those being kept from this one. keep swaps the two, so neither allocates once grown.
+	std::vector<std::pair<uint64_t, float>> previous, current;
+	size_t contacts = 0;	// Touching pairs in this update.
+	size_t hits = 0;		// Of those, the ones found in the last update.
+
+	void build(const std::vector<std::pair<uint32_t, uint32_t>> &pairs, const JointStore &joints, float restSpeed, bool warmStart);
+	void keep();
+	static uint64_t getKey(uint32_t a, uint32_t b) { return a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a; }
+};
+
+#endif // ContactCache_hpp
@@ -4,6 +4,12 @@
 #define _USE_MATH_DEFINES
 
 #include <math.h>
+#include <memory>
+#include <vector>
+#include "JointStore.hpp"
+#include "Span.hpp"
+
+class Spring;
 
 
 // Contains direction (angle) and magnitude (speed).
@@ -16,44 +22,54 @@ Vector operator+(Vector const& v1, Vector const& v2);
 
 
 // Handles the movement and forces acting upon the Joint and surrounding Joints.
+// A Joint is a handle to one slot of a JointStore; a free-standing Joint owns a single-slot store.
 class Joint {
+	friend struct JointStore;
+	friend class Environment;
 public:
 	Joint(float x, float y, float size, float mass, float speed, float angle, float elasticity, float drag);
-	Joint *getCollideWith() { return collideWith; }
-	float getAngle() { return angle; }
-	float getDrag() { return drag; }
-	float getElasticity() { return elasticity; }
-	float getMass() { return mass; }
-	float getSize() { return size; }
-	float getSpeed() { return speed; }
-	float getX() { return x; }
-	float getY() { return y; }
+	Joint(JointStore *store, size_t index);
+	Joint(const Joint&) = delete;
+	Joint *getCollideWith() { return store->collideWith[index]; }
+	float getAngle();
+	float getDrag() { return store->drag[index]; }
+	float getElasticity() { return store->elasticity[index]; }
+	size_t getIndex() { return index; }
+	float getMass() { return store->mass[index]; }
+	float getSize() { return store->size[index]; }
+	float getSpeed() { return hypot(store->vx[index], store->vy[index]); }
+	Span<Spring * const> getSprings() { return springs; }
+	JointStore *getStore() { return store; }
+	bool isAsleep() { return store->island[index] != JointStore::Awake; }
+	float getVelocityX() { return store->vx[index]; }
+	float getVelocityY() { return store->vy[index]; }
+	float getX() { return store->x[index]; }
+	float getY() { return store->y[index]; }
 	void accelerate(Vector vector);
+	void accelerate(float dvx, float dvy);
 	void attract(Joint *otherP);
 	void checkCollide(Joint *otherP);
+	static bool collide(JointStore *store, size_t index, JointStore *other, size_t o);
 	void combine(Joint *otherP);
 	void experienceDrag();
 	void move();
 	void moveTo(float moveX, float moveY);
-	void setAngle(float a) { angle = a; }
-	void setDrag(float d) { drag = d; }
-	void setElasticity(float e) { elasticity = e; }
-	void setMass(float m) { mass = m; }
-	void setSize(float s) { size = s; }
-	void setSpeed(float s) { speed = s; }
-	void setX(float xCoord) { x = xCoord; }
-	void setY(float yCoord) { y = yCoord; }
+	void setAngle(float a);
+	void setDrag(float d) { store->drag[index] = d; }
+	void setElasticity(float e) { store->elasticity[index] = e; }
+	void setMass(float m) { store->mass[index] = m; }
+	void setSize(float s) { store->size[index] = s; store->requestWake(index); }
+	void setSpeed(float s);
+	void setVelocity(float vx, float vy) { store->vx[index] = vx; store->vy[index] = vy; store->requestWake(index); }
+	void setX(float xCoord) { store->x[index] = xCoord; store->requestWake(index); }
+	void setY(float yCoord) { store->y[index] = yCoord; store->requestWake(index); }
 	
 protected:
-	float angle;
-	float drag;
-	float elasticity;
-	float mass;
-	float size;
-	float speed;
-	float x;
-	float y;
-	Joint *collideWith = NULL;
+	JointStore *store;
+	size_t index;
+	std::unique_ptr<JointStore> ownStore;
+	// Springs attached to the Joint in an Environment, removed along with it.
+	std::vector<Spring *> springs;
 };
 
 #endif // Joint_hpp
@@ -0,0 +1,49 @@
+// Header for the JointStore struct.
+#ifndef JointStore_hpp
+#define JointStore_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Joint;
+
+
+// Structure-of-arrays storage for Joint attributes. Each Joint is a handle to one slot.
+struct JointStore {
+	std::vector<float> x;
+	std::vector<float> y;
+	// Velocity is kept as Cartesian components; Joint derives angle and speed from them.
+	std::vector<float> vx;
+	std::vector<float> vy;
+	// Acceleration from the forces of the last update, kept for velocity Verlet.
+	std::vector<float> ax;
+	std::vector<float> ay;
+	std::vector<float> size;
+	std::vector<float> mass;
+	std::vector<float> drag;
+	std::vector<float> elasticity;
+	std::vector<Joint *> collideWith;
+	std::vector<Joint *> handles;
+	// Sleeping: the island each Joint sleeps in (Awake while it moves), and the updates it has spent at rest.
+	std::vector<uint32_t> island;
+	std::vector<uint32_t> restFrames;
+	// Multi-rate stepping: forces reach the Joint every 2^level updates.
+	std::vector<uint8_t> level;
+	// Identifies the Joint for as long as it is stored, whatever slot it moves to; never reused.
+	std::vector<uint32_t> id;
+	uint32_t nextId = 0;
+	// Islands holding a sleeping Joint that was changed from outside, woken by the next Environment::update.
+	std::vector<uint32_t> wakeRequests;
+	static const uint32_t Awake = UINT32_MAX;
+
+	size_t add(Joint *handle, float x, float y, float size, float mass, float speed, float angle, float elasticity, float drag);
+	size_t count() const { return x.size(); }
+	void permute(const std::vector<uint32_t> &order);
+	void remove(size_t index);
+	void requestWake(size_t index) { if (island[index] != Awake) wakeRequests.push_back(island[index]); }
+	void reserve(size_t n);
+	void swap(size_t a, size_t b);
+};
+
+#endif // JointStore_hpp
@@ -0,0 +1,25 @@
+// Header for the batch Joint kernels.
+#ifndef Kernels_hpp
+#define Kernels_hpp
+
+#include <cstddef>
+
+
+// Batch versions of the per-Joint passes of Environment::update, working on ranges of JointStore arrays.
+// Every implementation produces the same results as the scalar one.
+struct Kernels {
+	const char *name;
+	// Accelerates by (gx, gy), then moves by the new velocity over dt (Joint::accelerate followed by Joint::move).
+	void (*move)(float *x, float *y, float *vx, float *vy, float gx, float gy, float dt, size_t count);
+	// Scales velocities by drag (Joint::experienceDrag).
+	void (*drag)(float *vx, float *vy, const float *drag, size_t count);
+	// Reflects Joints off the boundaries of a width x height area (Environment::bounce).
+	void (*bounce)(float *x, float *y, float *vx, float *vy, const float *size, const float *elasticity, float width, float height, size_t count);
+	// Stops Joints slower than stable.
+	void (*settle)(float *vx, float *vy, float stable, size_t count);
+};
+
+const Kernels &getKernels();
+const Kernels &getScalarKernels();
+
+#endif // Kernels_hpp
@@ -6,20 +6,26 @@
 
 class Line
 {
+    friend class Environment;
 private:
     float StartX, StartY;
 	float EndX, EndY;
 	float width;
+    bool continuous = false; // Whether Joints are swept against this Line, so fast ones cannot pass through.
     Line *collideWith = NULL;
+    size_t index = 0; // Position in the Environment's list of Lines.
 
 public:
     Line(float StartX, float StartY, float EndX, float EndY, float LineWidth);
-    void checkCollide(Joint *P);
+    bool checkCollide(Joint *P);
+    float sweep(float fromX, float fromY, float toX, float toY, float radius, float &nx, float &ny);
     Line *getCollideWith() { return collideWith; }
+    void setContinuous(bool setting) { continuous = setting; }
     void setStartX(float xCoord) { StartX = xCoord; }
 	void setStartY(float yCoord) { StartY = yCoord; }
     void setEndX(float xCoord) { EndX = xCoord; }
 	void setEndY(float yCoord) { EndY = yCoord; }
+    bool getContinuous() { return continuous; }
     float getWidth() { return width; }
     float getStartX() { return StartX; }
 	float getStartY() { return StartY; }
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "QuadTree.hpp"
+
+// Bounding volume hierarchy over static boundaries (the Lines of an Environment).
+// Built once from a list of boundaries; queries report the index of every boundary intersecting a rectangle.
+class LineBVH {
+public:
+    void build(const std::vector<Rect> &bounds);
+    template <typename Visit>
+    void query(const Rect &bound, Visit visit) const;
+    unsigned totalNodes() const noexcept;
+private:
+    // Leaves hold up to LeafSize items; an inner node's children are at first and first + 1
+    static const unsigned LeafSize = 4;
+    struct Node {
+        Rect bound;
+        unsigned first; // First item for a leaf, first child otherwise
+        unsigned count; // Item count for a leaf, 0 otherwise
+    };
+    std::vector<Node>     nodes;
+    std::vector<unsigned> items; // Indices into the built bounds, grouped by leaf
+    std::vector<Rect>     itemBounds;
+
+    void split(unsigned node, unsigned first, unsigned count);
+};
+
+// Calls visit(index) for every boundary intersecting the provided one
+template <typename Visit>
+void LineBVH::query(const Rect &bound, Visit visit) const {
+    if (nodes.empty()) return;
+    unsigned stack[64];
+    unsigned top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        if (!node.bound.intersects(bound)) continue;
+        if (node.count > 0) {
+            for (unsigned i = node.first; i < node.first + node.count; ++i) {
+                if (itemBounds[items[i]].intersects(bound))
+                    visit(items[i]);
+            }
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = node.first + 1;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <utility>
+#include "QuadTree.hpp"
+#include "ThreadPool.hpp"
+
+// Quadtree kept as a flat array of objects sorted by the Morton code of the node holding them.
+// Rebuilt from scratch each frame: codes are computed and radix sorted in parallel, and the
+// objects in a node's branch are the run between its code and the code of the next branch.
+class LinearQuadTree {
+public:
+    LinearQuadTree(const Rect &_bound, unsigned _maxLevel);
+
+    void build(const std::vector<Collidable*> &objs, ThreadPool *pool = nullptr);
+    void getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const;
+    void getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs, ThreadPool *pool = nullptr);
+    unsigned totalObjects() const noexcept;
+private:
+    // Sort key: the node's Morton code at full depth above its level, so a node sorts before its branch
+    static const unsigned LevelBits = 5;
+    static const unsigned MaxLevel  = 15;
+    // Work is split into fixed blocks, so the result does not depend on the number of workers
+    static const size_t BlockSize = 4096;
+    // Branches with fewer objects than this are scanned in full rather than descended
+    static const size_t ScanLimit = 32;
+    struct Entry {
+        uint64_t key;
+        Collidable *obj;
+    };
+    // Full-depth cells covered by an object
+    struct Cells {
+        uint16_t left, top, right, bottom;
+    };
+    Rect     bounds;
+    unsigned maxLevel;
+    double   columnScale, rowScale; // Full-depth cells per unit of width and height
+    std::vector<Entry>    entries, sortBuffer;
+    std::vector<Rect>     sortedBounds;
+    std::vector<Cells>    sortedCells;
+    std::vector<unsigned> blockCounts; // Radix digit counts, 256 per block
+    std::vector<std::vector<std::pair<Collidable*, Collidable*>>> blockPairs;
+    std::vector<std::vector<uint32_t>> blockPaths; // Objects reaching each level of a block's path
+
+    uint64_t getKey(const Rect &bound) const noexcept;
+    uint64_t getAncestorKey(uint64_t code, unsigned level) const noexcept;
+    unsigned getCell(double offset, double scale) const noexcept;
+    size_t getBranchEnd(size_t first, size_t last, uint64_t code) const noexcept;
+    void getRange(const Rect &bound, unsigned range[4]) const noexcept;
+    template <typename Visit>
+    void visitBranch(unsigned column, unsigned row, unsigned level, size_t first, size_t last,
+                     const unsigned range[4], Visit &&visit) const;
+    static void forBlocks(size_t count, ThreadPool *pool, const std::function<void(size_t block, size_t begin, size_t end)> &task);
+};
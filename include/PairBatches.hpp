@@ -0,0 +1,27 @@
+// Header for the PairBatches struct.
+#ifndef PairBatches_hpp
+#define PairBatches_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+// Groups pairs of Joint indices into batches in which no Joint appears twice (a greedy graph colouring),
+// so the pairs of one batch can be resolved in parallel. The grouping only depends on the order of the pairs.
+struct PairBatches {
+	// Stands in for the missing side of a pair that only involves one Joint.
+	static const uint32_t None = UINT32_MAX;
+	std::vector<uint32_t> order;	// Pair indices, batch by batch.
+	std::vector<uint32_t> starts;	// Batch b covers order[starts[b]] to order[starts[b + 1] - 1].
+
+	void build(const std::vector<std::pair<uint32_t, uint32_t>> &pairs, size_t jointCount);
+	size_t count() const { return starts.empty() ? 0 : starts.size() - 1; }
+
+private:
+	std::vector<uint64_t> used;		// Batches already holding each Joint.
+	std::vector<uint32_t> batchOf;	// Batch chosen for each pair.
+};
+
+#endif // PairBatches_hpp
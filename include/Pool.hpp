@@ -0,0 +1,133 @@
+// Header for the Pool class template and Handle struct.
+#ifndef Pool_hpp
+#define Pool_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+// Refers to an object in a Pool. The generation tells a handle to a removed object apart from
+// one to a newer object reusing the same slot.
+template <typename T>
+struct Handle {
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+	bool operator==(const Handle &other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Handle &other) const { return !(*this == other); }
+};
+
+
+// Slab allocator for objects of one type. Slabs never move, so pointers to objects stay valid
+// until they are destroyed, and freed slots are reused through a freelist.
+template <typename T>
+class Pool {
+public:
+	Pool() = default;
+	Pool(const Pool&) = delete;
+	~Pool();
+	template <typename... Args>
+	T *create(Args&&... args);
+	void destroy(T *object);
+	T *get(Handle<T> handle);
+	Handle<T> getHandle(T *object);
+	size_t count() { return live; }
+	
+protected:
+	static const uint32_t SlabSize = 256;
+	static const uint32_t None = UINT32_MAX;
+	// The storage comes first, so a pointer to the object is also a pointer to its slot.
+	struct Slot {
+		alignas(T) unsigned char storage[sizeof(T)];
+		uint32_t index;
+		uint32_t generation;
+		uint32_t nextFree;
+		bool alive;
+	};
+	std::vector<std::unique_ptr<Slot[]>> slabs;
+	uint32_t freeList = None;
+	uint32_t slotCount = 0;
+	size_t live = 0;
+	Slot &getSlot(uint32_t index) { return slabs[index / SlabSize][index % SlabSize]; }
+};
+
+
+// Pool destructor. Destroys the objects still alive.
+template <typename T>
+Pool<T>::~Pool() {
+	for (uint32_t i = 0; i < slotCount; i++) {
+		Slot &slot = getSlot(i);
+		if (slot.alive) {
+			reinterpret_cast<T *>(slot.storage)->~T();
+		}
+	}
+}
+
+
+// Constructs an object in a free slot, adding a slab when none is left, and returns a pointer to it.
+template <typename T>
+template <typename... Args>
+T *Pool<T>::create(Args&&... args) {
+	uint32_t index = freeList;
+	if (index != None) {
+		freeList = getSlot(index).nextFree;
+	} else {
+		if (slotCount % SlabSize == 0) {
+			slabs.emplace_back(new Slot[SlabSize]);
+			for (uint32_t i = 0; i < SlabSize; i++) {
+				slabs.back()[i].index = slotCount + i;
+				slabs.back()[i].generation = 0;
+				slabs.back()[i].alive = false;
+			}
+		}
+		index = slotCount++;
+	}
+	Slot &slot = getSlot(index);
+	T *object = new (slot.storage) T(std::forward<Args>(args)...);
+	slot.alive = true;
+	live++;
+	return object;
+}
+
+
+// Destroys an object and puts its slot on the freelist. Handles to it become stale.
+template <typename T>
+void Pool<T>::destroy(T *object) {
+	Slot *slot = reinterpret_cast<Slot *>(object);
+	if (!slot->alive) {
+		return;
+	}
+	object->~T();
+	slot->alive = false;
+	slot->generation++;
+	slot->nextFree = freeList;
+	freeList = slot->index;
+	live--;
+}
+
+
+// Returns the object a handle refers to, or nullptr if it has been destroyed.
+template <typename T>
+T *Pool<T>::get(Handle<T> handle) {
+	if (handle.index >= slotCount) {
+		return nullptr;
+	}
+	Slot &slot = getSlot(handle.index);
+	if (!slot.alive || slot.generation != handle.generation) {
+		return nullptr;
+	}
+	return reinterpret_cast<T *>(slot.storage);
+}
+
+
+// Returns a handle to an object created by this pool.
+template <typename T>
+Handle<T> Pool<T>::getHandle(T *object) {
+	Slot *slot = reinterpret_cast<Slot *>(object);
+	return Handle<T>{slot->index, slot->generation};
+}
+
+#endif // Pool_hpp
@@ -1,7 +1,9 @@
 #pragma once
-#include <any>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <algorithm>
+#include <utility>
 
 struct Rect {
     double x, y, width, height;
@@ -14,18 +16,30 @@ struct Rect {
     double getBottom() const noexcept;
 
     Rect(const Rect&);
+    Rect &operator=(const Rect&) = default;
     Rect(double _x = 0, double _y = 0, double _width = 0, double _height = 0);
 };
+// Identifies what a Collidable stands for: a kind chosen by the owner and an index within that kind
+struct CollidableId {
+    uint32_t kind  = 0;
+    uint32_t index = 0;
+};
+
 class QuadTree;
 struct Collidable {
     friend class QuadTree;
+    friend class SweepAndPrune;
 public:
     Rect bound;
-    std::any data;
+    CollidableId data;
+    double mass = 0; // Used by QuadTree::getAttraction
 
-    Collidable(const Rect &_bounds = {}, std::any _data = {});
+    Collidable(const Rect &_bounds = {}, CollidableId _data = {});
 private:
     QuadTree *qt = nullptr;
+    Rect fatBound;      // bound enlarged by the tree's margin when placed; the object moves node only once it leaves
+    bool dirty = false; // Queued for reinsertion by QuadTree::refit
+    uint32_t sweepIndex = 0; // Entry of the object in a SweepAndPrune, so removing it needs no search
     Collidable(const Collidable&) = delete;
 };
 
@@ -38,23 +52,59 @@ public:
     bool insert(Collidable *obj);
     bool remove(Collidable *obj);
     bool update(Collidable *obj);
-    std::vector<Collidable*> &getObjectsInBound(const Rect &bound);
+    bool refit(Collidable *obj);
+    void updateDirty();
+    void setMargin(double margin) noexcept;
+    double getMargin() const noexcept;
+    void getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const;
+    template <typename Visitor>
+    void query(const Rect &bound, Visitor &&visit) const;
+    void getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs) const;
+    void updateMass() noexcept;
+    void getAttraction(const Collidable *obj, double theta, double &ax, double &ay) const noexcept;
     unsigned totalChildren() const noexcept;
     unsigned totalObjects() const noexcept;
     void clear() noexcept;
 
     ~QuadTree();
 private:
+    struct NodePool;
     bool      isLeaf = true;
     unsigned  level  = 0;
     unsigned  capacity;
     unsigned  maxLevel;
+    double    margin = 0;
     Rect      bounds;
+    double    mass = 0, massX = 0, massY = 0; // Total mass and centre of mass of this branch
     QuadTree* parent = nullptr;
     QuadTree* children[4] = { nullptr, nullptr, nullptr, nullptr };
-    std::vector<Collidable*> objects, foundObjects;
+    NodePool* pool = nullptr;             // Shared by every node of the tree, owned by the root
+    std::unique_ptr<NodePool> ownPool;
+    std::vector<Collidable*> objects;
+    std::vector<Collidable*> dirty;       // Objects queued by refit, kept by the root
 
+    void fatten(Collidable *obj) const noexcept;
     void subdivide();
     void discardEmptyBuckets();
-    inline QuadTree *getChild(const Rect &bound) const noexcept;
+    void getIntersections(Collidable *obj, std::vector<std::pair<Collidable*, Collidable*>> &pairs) const;
+    QuadTree *getChild(const Rect &bound) const noexcept;
 };
+
+// Calls visit(Collidable*) for every object whose boundary intersects the provided one, without allocating
+template <typename Visitor>
+void QuadTree::query(const Rect &bound, Visitor &&visit) const {
+    for (Collidable *obj : objects) {
+        // Only check for intersection with OTHER boundaries
+        if (&obj->bound != &bound && obj->bound.intersects(bound))
+            visit(obj);
+    }
+    if (!isLeaf) {
+        // Descend into the one child holding the boundary, or every child it touches
+        if (QuadTree *child = getChild(bound)) {
+            child->query(bound, visit);
+        } else for (QuadTree *leaf : children) {
+            if (leaf->bounds.intersects(bound))
+                leaf->query(bound, visit);
+        }
+    }
+}
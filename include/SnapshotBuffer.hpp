@@ -0,0 +1,78 @@
+// Header for the SnapshotBuffer class.
+#ifndef SnapshotBuffer_hpp
+#define SnapshotBuffer_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Position and size of one Joint, packed for copying straight into a vertex buffer: three floats per Joint.
+struct JointVertex {
+	float x, y;
+	float size;
+};
+static_assert(sizeof(JointVertex) == 3 * sizeof(float), "JointVertex must be packed");
+
+
+// The positions of the Joints at the end of one update, for reading on other threads.
+struct Snapshot {
+	uint64_t update = 0;			// Environment updates run when it was taken.
+	std::vector<JointVertex> joints;
+	std::vector<uint32_t> ids;		// Id of each Joint, which stays with it as the Joints change order.
+};
+
+
+// Snapshots published by one writer and read by any number of threads, none of which ever waits for another.
+// Each slot counts the readers holding it. The writer fills a slot that is neither the latest nor held,
+// then makes it the latest; readers hold the latest slot until they release it. With a slot for each
+// reader, one for the latest and one to write, a free slot is always found; should more readers hold
+// slots than that, the writer drops the snapshot rather than wait (getDropped).
+class SnapshotBuffer {
+public:
+	// A reader's hold on a published Snapshot, released when it goes out of scope. Empty before the
+	// first publish.
+	class Lease {
+	public:
+		Lease() = default;
+		Lease(Lease &&other) noexcept : buffer(other.buffer), slot(other.slot) { other.buffer = nullptr; }
+		Lease & operator=(Lease &&other) noexcept;
+		Lease(const Lease &) = delete;
+		Lease & operator=(const Lease &) = delete;
+		~Lease() { release(); }
+
+		explicit operator bool() const { return buffer != nullptr; }
+		const Snapshot & operator*() const { return buffer->slots[slot]; }
+		const Snapshot * operator->() const { return &buffer->slots[slot]; }
+		void release();
+
+	private:
+		friend class SnapshotBuffer;
+		Lease(const SnapshotBuffer *buffer, size_t slot) : buffer(buffer), slot(slot) {}
+		const SnapshotBuffer *buffer = nullptr;
+		size_t slot = 0;
+	};
+
+	explicit SnapshotBuffer(unsigned readers=2);
+
+	Lease acquire() const;
+	Snapshot * write();
+	void publish();
+	void setReaders(unsigned readers);
+
+	size_t getDropped() const { return dropped; }
+	size_t getPublished() const { return published; }
+	unsigned getReaders() const { return (unsigned)slots.size() - 2; }
+
+private:
+	static const size_t None = SIZE_MAX;
+	std::vector<Snapshot> slots;
+	mutable std::vector<std::atomic<uint32_t>> holds;	// Readers holding each slot.
+	std::atomic<size_t> latest{None};
+	size_t writing = None;		// Slot handed out by write, published next.
+	size_t dropped = 0;
+	size_t published = 0;
+};
+
+#endif // SnapshotBuffer_hpp
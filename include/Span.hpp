@@ -0,0 +1,35 @@
+// Header for the Span struct.
+#ifndef Span_hpp
+#define Span_hpp
+
+#include <cstddef>
+#include <vector>
+
+
+// Non-owning view of a run of elements held by the Environment, such as its Joints or the packed buffer
+// from Environment::getJointVertices. Reading through it copies nothing. A view stays valid until the
+// Environment next adds, removes or reorders what it shows: an update can change the order of Joints.
+template <typename T>
+struct Span {
+	T *first = nullptr;
+	size_t length = 0;
+
+	Span() = default;
+	Span(T *first, size_t length) : first(first), length(length) {}
+	template <typename U>
+	Span(const std::vector<U> &vector) : first(vector.data()), length(vector.size()) {}
+	template <typename U>
+	Span(std::vector<U> &vector) : first(vector.data()), length(vector.size()) {}
+
+	T * begin() const { return first; }
+	T * end() const { return first + length; }
+	T * data() const { return first; }
+	size_t size() const { return length; }
+	size_t bytes() const { return length * sizeof(T); }
+	bool empty() const { return length == 0; }
+	T & operator[](size_t i) const { return first[i]; }
+	T & front() const { return first[0]; }
+	T & back() const { return first[length - 1]; }
+};
+
+#endif // Span_hpp
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "QuadTree.hpp"
+
+// Uniform grid over Collidables of similar size. Each object is binned by the cell
+// holding its centre, so cells must be at least as wide as the largest object.
+class SpatialGrid {
+public:
+    SpatialGrid(const Rect &_bound, double _cellSize);
+
+    void rebuild(const std::vector<Collidable*> &objs);
+    void getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const;
+    void getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs) const;
+    void setCellSize(double size) noexcept;
+    double getCellSize() const noexcept;
+    unsigned totalCells() const noexcept;
+private:
+    Rect     bounds;
+    double   cellSize;
+    unsigned columns = 1;
+    unsigned rows    = 1;
+    std::vector<unsigned>    cellStart;   // Offset of each cell's run in cellObjects
+    std::vector<unsigned>    objectCells; // Cell of each object passed to rebuild
+    std::vector<Collidable*> cellObjects;
+
+    void resize();
+    inline unsigned getColumn(double x) const noexcept;
+    inline unsigned getRow(double y) const noexcept;
+    inline void pairCells(unsigned a, unsigned b, std::vector<std::pair<Collidable*, Collidable*>> &pairs) const;
+};
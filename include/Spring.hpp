@@ -9,6 +9,8 @@
 
 // Handles the movement and forces acting upon the spring.
 class Spring {
+	friend class Environment;
+	friend struct SpringStore;
 public:
 	Spring(Joint *p1, Joint *p2, float restlength=50, float strength=0.5);
 	Joint *getP1() { return p1; }
@@ -20,6 +22,7 @@ protected:
 	float strength;
 	Joint *p1;
 	Joint *p2;
+	size_t index = 0; // Slot in the Environment's SpringStore.
 };
 
 #endif // spring_hpp
@@ -0,0 +1,30 @@
+// Header for the SpringStore struct.
+#ifndef SpringStore_hpp
+#define SpringStore_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class Spring;
+
+
+// Structure-of-arrays storage for the springs of an Environment, so spring passes read compact arrays
+// instead of following Spring and Joint pointers.
+struct SpringStore {
+	// JointStore indices of the two ends, kept current by the Environment as Joints change slots.
+	std::vector<std::pair<uint32_t, uint32_t>> ends;
+	std::vector<float> length;
+	std::vector<float> strength;
+	// Position-based solver: the multiplier each spring has built up during the current update.
+	std::vector<float> lambda;
+	std::vector<Spring *> handles;
+
+	size_t add(Spring *handle, uint32_t p1, uint32_t p2, float length, float strength);
+	size_t count() const { return handles.size(); }
+	void remove(size_t index);
+	void reserve(size_t n);
+};
+
+#endif // SpringStore_hpp
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "QuadTree.hpp"
+
+// Sweep and prune over Collidables. Objects are kept sorted by their left edge between
+// updates, so re-sorting objects that moved a little is close to linear. Removed objects leave
+// an empty entry behind until the next update closes the gaps.
+class SweepAndPrune {
+public:
+    bool insert(Collidable *obj);
+    bool remove(Collidable *obj);
+    void update();
+    void getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const;
+    void getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs) const;
+    unsigned totalObjects() const noexcept;
+    void clear() noexcept;
+private:
+    // Endpoints of an object on the sweep axis, cached next to it for the sweep. obj is null once removed
+    struct Entry {
+        double min, max;
+        Collidable *obj;
+    };
+    std::vector<Entry> entries;
+    size_t removed = 0; // Entries emptied since the gaps were last closed
+    void compact();
+};
@@ -0,0 +1,41 @@
+// Header for the ThreadPool class.
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Runs loops over a range of items on a fixed set of worker threads.
+// The range is split into contiguous chunks, one per worker, with the calling thread taking the first.
+class ThreadPool {
+public:
+	ThreadPool(unsigned workers=1);
+	~ThreadPool();
+	unsigned getWorkerCount() { return workerCount; }
+	void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &task);
+	void setWorkerCount(unsigned workers);
+	
+protected:
+	// Chunks smaller than this are not worth handing to another thread.
+	static const size_t MinChunk = 256;
+	unsigned workerCount = 1;
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(size_t, size_t)> *task = nullptr;
+	size_t taskCount = 0;
+	unsigned taskChunks = 0;
+	unsigned generation = 0;
+	unsigned pending = 0;
+	bool stopping = false;
+	void start(unsigned workers);
+	void stop();
+	void work(unsigned worker, unsigned seen);
+};
+
+#endif // ThreadPool_hpp
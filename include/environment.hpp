@@ -5,69 +5,329 @@
 #define M_PI 3.14159265359 
 
 #include <math.h>
+#include <atomic>
+#include <chrono>
+#include <string>
 #include <random>
 #include <algorithm>
 #include "Joint.hpp"
+#include "JointStore.hpp"
+#include "CommandQueue.hpp"
+#include "ContactCache.hpp"
+#include "Kernels.hpp"
 #include "Line.hpp"
+#include "SnapshotBuffer.hpp"
+#include "Span.hpp"
 #include "Spring.hpp"
+#include "SpringStore.hpp"
 #include "QuadTree.hpp"
+#include "SpatialGrid.hpp"
+#include "SweepAndPrune.hpp"
+#include "LinearQuadTree.hpp"
+#include "LineBVH.hpp"
+#include "PairBatches.hpp"
+#include "Pool.hpp"
+#include "ThreadPool.hpp"
+
+// Structures the Environment can use to find touching Joints.
+enum class BroadPhase {
+	QuadTree,		// Adapts to uneven Joint sizes and clustering.
+	Grid,			// Uniform grid; fastest when Joints are of similar size.
+	SweepAndPrune,	// Persistent sorted order; fastest when Joints move little per update. Also holds Lines.
+	LinearQuadTree	// Rebuilt in parallel every update from sorted Morton codes; suits scenes where everything moves.
+};
+
+// Ways the Environment can advance Joints through a step of time.
+enum class Integrator {
+	SemiImplicitEuler,	// Velocity first, then position from the new velocity; what update has always done.
+	VelocityVerlet		// Half of the acceleration before moving and half after; second order, so it takes larger steps.
+};
+
+// Ways the Environment can move Joints joined by springs.
+enum class SpringSolver {
+	Force,	// Each spring accelerates its ends once per update (Spring::update).
+	XPBD	// Springs correct positions directly over several iterations; stays stable with stiff springs.
+};
+
+// Ways the Environment can separate touching Joints.
+enum class ContactSolver {
+	Bounce,		// Each touching pair bounces apart once per update and is pushed out of overlap (Joint::collide).
+	Impulse		// Impulses over several iterations, started from the last update's; piles come to rest.
+};
+
+// Stages of Environment::update, timed while instrumentation is on (getPhaseTime).
+enum class Phase {
+	Prepare,	// Waking and reordering Joints.
+	Integrate,	// Moving Joints by their velocities.
+	BroadPhase,	// Finding the pairs of Joints that may touch.
+	Contacts,	// Colliding and combining touching Joints.
+	Attraction,	// Exact or Barnes-Hut attraction.
+	Lines,		// Colliding Joints with Lines.
+	Springs,	// Pulling or projecting springs.
+	Finish,		// Closing kicks and putting Joints to sleep.
+	Count
+};
+
+// Work done by Environment::update, counted while instrumentation is on (getCounter).
+enum class Counter {
+	CandidatePairs,	// Pairs reported by the broad phase.
+	NarrowTests,	// Joint-Joint and Joint-Line pairs tested for touching. Sweeps are not counted.
+	Contacts,		// Tested pairs that touched.
+	TreeReinserts,	// Joints that left their margin and were placed again in the QuadTree.
+	TreeNodes,		// Nodes below the QuadTree's root (QuadTree::totalChildren).
+	Count
+};
+
+// Kinds of object the Environment's Collidables stand for, kept in CollidableId::kind.
+enum CollidableKind : uint32_t {
+	JointCollidable,	// CollidableId::index is the Joint's index.
+	LineCollidable		// CollidableId::index is the Line's position in getLines().
+};
+
+// Generation-checked references to objects in an Environment. They stop resolving once the object is removed.
+typedef Handle<Joint> JointHandle;
+typedef Handle<Spring> SpringHandle;
+typedef Handle<Line> LineHandle;
 
 // Handles all interaction between Joints, springs and attributes within the environment.
 class Environment {
 public:
-	Environment(int width, int height, Vector GravVector);
+	Environment(int width, int height, Vector GravVector, BroadPhase broadPhase=BroadPhase::QuadTree);
 	~Environment();
+	size_t getActiveCount() { return allowMultiRate ? activeCount : awakeCount; }
+	size_t getAsleepCount() { return Joints.count() - awakeCount; }
+	size_t getAwakeCount() { return awakeCount; }
+	BroadPhase getBroadPhase() { return broadPhase; }
+	size_t getContactCount() { return Contacts.contacts; }
+	size_t getContactHits() { return Contacts.hits; }
+	float getContactHitRate() { return Contacts.contacts ? (float)Contacts.hits / Contacts.contacts : 0; }
 	int getHeight() { return height; }
+	size_t getPendingCommands() { return Commands.getPending(); }
+	float getInterpolation() { return accumulator / timeStep; }
+	size_t getCounter(Counter counter) { return counters[(int)counter]; }
+	static const char * getCounterName(Counter counter);
+	static const char * getPhaseName(Phase phase);
+	double getPhaseTime(Phase phase) { return phaseTimes[(int)phase]; }
+	unsigned getWorkerCount() { return threadPool.getWorkerCount(); }
 	int getWidth() { return width; }
 
 	Joint * addJoint();
 	Joint * addJoint(float x, float y, float size=10, float mass=100, float speed=0, float angle=0, float elasticity=0.9);
 	Joint * getJoint(float x, float y);
+	Joint * getJoint(JointHandle handle) { return JointPool.get(handle); }
+	JointHandle getHandle(Joint *joint) { return JointPool.getHandle(joint); }
 
 	Line * addLine(float StartX, float StartY, float EndX, float EndY, float LineWidth);
 	Line * getLine(float x, float y);
+	Line * getLine(LineHandle handle) { return LinePool.get(handle); }
+	LineHandle getHandle(Line *line) { return LinePool.getHandle(line); }
+	static Rect getLineBound(Line *line);
 
 	Spring * addSpring(Joint *p1, Joint *p2, float length=50, float strength=0.5);
+	Spring * getSpring(SpringHandle handle) { return SpringPool.get(handle); }
+	SpringHandle getHandle(Spring *spring) { return SpringPool.getHandle(spring); }
 
 
-	std::vector<Joint*>	getJoints() { return Joints; }
-	std::vector<Line *> getLines() 	{ return Lines;  }
-	std::vector<Spring*>getSprings(){ return Springs;}
+	Span<Joint * const>	getJoints() { return Joints.handles; }
+	Span<Line * const>	getLines() 	{ return Lines;  }
+	Span<Spring * const>getSprings(){ return Springs.handles;}
+	Span<const JointVertex> getJointVertices();
+	SnapshotBuffer::Lease getSnapshot() const { return Snapshots.acquire(); }
+	SnapshotBuffer & getSnapshots() { return Snapshots; }
+	Span<const std::pair<uint32_t, uint32_t>> getSpringEnds() { return Springs.ends; }
+	Span<const float> getXs() { return Joints.x; }
+	Span<const float> getYs() { return Joints.y; }
+	Span<const float> getSizes() { return Joints.size; }
 	
 
 	void bounce(Joint *Joint);
+	// Call after moving a Line through its setters: the Line hierarchy is only rebuilt when told, and
+	// collisions would keep using the Line's old bounds.
+	void refreshLines() { linesMoved = true; }
+	void reorder();
+	// Thread-safe: any thread may queue these while the Environment updates. They are applied in the
+	// order queued at the start of the next update.
+	void queueAddJoint(float x, float y, float size=10, float mass=100, float speed=0, float angle=0, float elasticity=0.9,
+		std::function<void(JointHandle)> added=nullptr);
+	void queueAddSpring(JointHandle p1, JointHandle p2, float length=50, float strength=0.5);
+	void queueImpulse(JointHandle joint, float ix, float iy);
+	void queueMoveTo(JointHandle joint, float x, float y);
+	void queueRemoveJoint(JointHandle joint);
+
 	void removeJoint(Joint *Joint);
+	void removeJoint(JointHandle handle);
+	void removeLine(Line *line);
+	void removeLine(LineHandle handle);
 	void removeSpring(Spring *spring);
+	void removeSpring(SpringHandle handle);
 	void setAirMass(float a) { airMass = a; }
 	void setAllowAccelerate(bool setting) { allowAccelerate = setting; }
 	void setAllowAttract(bool setting) { allowAttract = setting; }
+	void setAllowBarnesHut(bool setting);
+	void setBarnesHutTheta(float theta) { barnesHutTheta = theta; }
 	void setAllowBounce(bool setting) { allowBounce = setting; }
 	void setAllowCollide(bool setting) { allowCollide = setting; }
 	void setAllowCombine(bool setting) { allowCombine = setting; }
+	void setAllowContinuousCollide(bool setting) { allowContinuousCollide = setting; }
 	void setAllowDrag(bool setting) { allowDrag = setting; }
+	void setAllowInstrument(bool setting) { allowInstrument = setting; }
 	void setAllowMove(bool setting) { allowMove = setting; }
+	void setAllowMultiRate(bool setting) { allowMultiRate = setting; }
+	void setAllowSleep(bool setting);
+	void setAllowSnapshots(bool setting) { allowSnapshots = setting; }
+	void setAllowTrace(bool setting);
+	void setAllowWarmStart(bool setting) { allowWarmStart = setting; }
+	void setContactIterations(unsigned iterations) { contactIterations = iterations; }
+	void setContactSolver(ContactSolver solver) { contactSolver = solver; }
 	void setElasticity(float e) { elasticity = e; }
-	void update();
+	void setIntegrator(Integrator setting) { integrator = setting; }
+	void setMaxSteps(unsigned steps) { maxSteps = steps; }
+	void setMultiRateLevels(unsigned levels) { multiRateLevels = std::min(levels, 31u); }
+	void setMultiRateTolerance(float tolerance) { multiRateTolerance = tolerance; }
+	void setReorderInterval(unsigned updates) { reorderInterval = updates; }
+	void setSpringIterations(unsigned iterations) { springIterations = iterations; }
+	void setSpringSolver(SpringSolver solver) { springSolver = solver; }
+	void setSleepFrames(unsigned frames) { sleepFrames = frames; }
+	void setSleepSpeed(float speed) { sleepSpeed = speed; }
+	void setTimeStep(float dt) { timeStep = dt; }
+	void setTreeMargin(float margin);
+	void setWorkerCount(unsigned workers) { threadPool.setWorkerCount(workers); }
+	unsigned step(float dt, unsigned substeps=1);
+	void clearTrace() { TraceSpans.clear(); TraceCounts.clear(); }
+	bool writeTrace(const std::string &path);
+	void update(float dt=1);
 	
 protected:
 	const int height;
 	const int width;
 	const float Stable = 0.15f;
+	// The impulse solver leaves ContactSlop of overlap and removes ContactRelax of the rest per iteration.
+	const float ContactSlop = 0.05f;
+	const float ContactRelax = 0.2f;
 	bool allowAccelerate = true;
 	bool allowAttract = false;
+	bool allowBarnesHut = false;
 	bool allowBounce = true;
 	bool allowCollide = true;
 	bool allowCombine = false;
+	bool allowContinuousCollide = false;
 	bool allowDrag = true;
+	bool allowInstrument = false;
 	bool allowMove = true;
+	bool allowMultiRate = false;
+	bool allowSleep = false;
+	bool allowSnapshots = false;
+	bool allowTrace = false;
+	bool allowWarmStart = true;
 	float airMass = 0.2;
+	float barnesHutTheta = 0.5;
 	float elasticity = 0.75;
-	std::vector<Joint *> Joints;
-	std::vector<Spring *> Springs;
+	unsigned sleepFrames = 60;
+	float sleepSpeed = 0.5;
+	float treeMargin = 0;
+	unsigned reorderInterval = 0;
+	Integrator integrator = Integrator::SemiImplicitEuler;
+	float timeStep = 1;
+	unsigned maxSteps = 8;
+	float accumulator = 0;
+	float stepTime = 1;	// Length of the update in progress.
+	unsigned multiRateLevels = 4;
+	float multiRateTolerance = 0.01;
+	uint64_t updateCount = 0;
+	// Instrumentation: milliseconds each phase of the last update took, when the phase in progress began,
+	// and the counters of the last update.
+	double phaseTimes[(int)Phase::Count] = {};
+	std::chrono::steady_clock::time_point phaseStart;
+	size_t counters[(int)Counter::Count] = {};
+	bool instrumenting = false;			// allowInstrument or allowTrace, for the update in progress.
+	std::atomic<size_t> touches{0};		// Contacts found by the parallel tests.
+	// Tracing: each update's phases, as microseconds since traceStart, and its counters.
+	struct TraceSpan {
+		Phase phase;
+		double start, duration;
+	};
+	struct TraceCount {
+		double time;
+		size_t counters[(int)Counter::Count];
+	};
+	std::chrono::steady_clock::time_point traceStart;
+	std::vector<TraceSpan> TraceSpans;
+	std::vector<TraceCount> TraceCounts;
+	std::vector<JointVertex> JointVertices;	// Packed by getJointVertices, in the order of getJoints.
+	CommandQueue Commands;					// Queued by other threads, applied as each update starts.
+	SnapshotBuffer Snapshots;				// Published at the end of each update, for other threads.
+	size_t activeCount = 0;
+	SpringSolver springSolver = SpringSolver::Force;
+	unsigned springIterations = 4;
+	ContactSolver contactSolver = ContactSolver::Bounce;
+	unsigned contactIterations = 4;
+	bool springsChanged = true;
+	unsigned updatesSinceReorder = 0;
+	// Pools are declared first so they outlive the structures that refer to their objects.
+	Pool<Joint> JointPool;
+	Pool<Spring> SpringPool;
+	Pool<Line> LinePool;
+	Pool<Collidable> CollidablePool;
+	JointStore Joints;
+	SpringStore Springs;
+	ContactCache Contacts;
+	std::vector<float> StepDrag;
+	std::vector<float> ContactVx, ContactVy;	// Awake Joints' velocities before the impulse solver.
+	std::vector<float> WallImpulseX, WallImpulseY;	// Impulse each awake Joint's walls have built up.
+	std::vector<float> SweepX, SweepY;	// Awake Joints' positions at the start of the update in progress.
 	std::vector<Line *> Lines;
 	std::vector<Collidable*> Collidables;
-	QuadTree *quadTree;
+	std::vector<std::pair<Collidable*, Collidable*>> Pairs;
+	std::vector<std::pair<uint32_t, uint32_t>> PairJoints;
+	std::vector<uint64_t> ReorderKeys;
+	std::vector<uint32_t> ReorderOrder;
+	std::vector<Collidable*> ReorderCollidables;
+	std::vector<std::pair<Rect, double>> ReorderContents;
+	PairBatches PairOrder;
+	PairBatches SpringOrder;
+	ThreadPool threadPool;
+	const BroadPhase broadPhase;
+	QuadTree *quadTree = nullptr;
+	SpatialGrid *grid = nullptr;
+	SweepAndPrune *sweepAndPrune = nullptr;
+	LinearQuadTree *linearTree = nullptr;
+	std::vector<Collidable*> LineCollidables;
+	LineBVH lineBVH;
+	bool linesMoved = false;
+	// Joints 0 to awakeCount - 1 are awake; the rest sleep in the islands listed in Islands.
+	size_t awakeCount = 0;
+	std::vector<std::vector<Joint *>> Islands;
+	std::vector<uint32_t> FreeIslands;
+	std::vector<uint32_t> IslandParent;
+	std::vector<uint32_t> IslandRest;
+	std::vector<uint32_t> IslandsAsleep;
 	Vector acceleration = {M_PI, 0.2};
+	void accelerateJoint(size_t i, float ax, float ay);
+	void attractPair(size_t i, size_t j);
+	void bounceWalls(size_t begin, size_t end, float restSpeed);
+	void clampWalls(size_t begin, size_t end);
+	void clearAcceleration(size_t i);
+	void applyCommands();
+	void endPhase(Phase phase);
+	void publishSnapshot();
+	void holdWalls(size_t begin, size_t end);
+	void integrate(size_t begin, size_t end);
+	// Whether forces reach Joint i in this update under multi-rate stepping.
+	bool isActive(size_t i) { return (updateCount & ((uint64_t(1) << Joints.level[i]) - 1)) == 0; }
+	void kickMultiRate(size_t count);
+	void projectSpring(size_t i);
+	void pushContact(size_t i, float impulse);
+	void relaxContact(size_t i);
+	void solveContact(size_t i);
+	void pullSpring(size_t i);
+	void refreshSpringEnds(Joint *joint);
+	void resolvePair(size_t i);
+	void sleepIslands();
+	void sweepLines(size_t i);
+	void swapJoints(size_t a, size_t b);
+	void wake(Joint *joint);
+	void wakeAll();
+	void wakeIsland(uint32_t island);
 };
 
 #endif // environment_hpp
@@ -0,0 +1,134 @@
+// Contains member functions of the CommandQueue class.
+// Lock-free hand-over of Commands from any thread to the one updating the Environment.
+#include "../include/CommandQueue.hpp"
+#include <cstdint>
+
+
+// CommandQueue constructor. Every spare slot starts free to fill on the first lap.
+CommandQueue::CommandQueue() {
+	for (size_t i = 0; i < Spares; i++) {
+		spares[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+
+// CommandQueue destructor. Deletes the Commands never applied and the spare ones.
+CommandQueue::~CommandQueue() {
+	while (Command *command = pop()) {
+		delete command;
+	}
+	while (Command *command = takeSpare()) {
+		delete command;
+	}
+}
+
+
+// Returns a Command of kind to fill in and push, reusing a spare one when there is one. Only the fields
+// its kind reads need setting. Any thread may call it.
+Command * CommandQueue::make(Command::Kind kind) {
+	Command *command = takeSpare();
+	if (!command) {
+		return new Command(kind);
+	}
+	command->kind = kind;
+	return command;
+}
+
+
+// Takes a spare Command, or nullptr if there is none. A slot holds a Command for the lap after the one
+// it was filled on; a slot still on an older lap means the ring is empty.
+Command * CommandQueue::takeSpare() {
+	size_t position = spareOut.load(std::memory_order_relaxed);
+	while (true) {
+		Spare &spare = spares[position & (Spares - 1)];
+		const size_t sequence = spare.sequence.load(std::memory_order_acquire);
+		const intptr_t lap = (intptr_t)sequence - (intptr_t)(position + 1);
+		if (lap == 0) {
+			if (spareOut.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				Command *command = spare.command;
+				spare.sequence.store(position + Spares, std::memory_order_release);
+				return command;
+			}
+		} else if (lap < 0) {
+			return nullptr;
+		} else {
+			position = spareOut.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+
+// Adds a Command from make; the queue owns it from here. Any thread may call it.
+void CommandQueue::push(Command *command) {
+	pending.fetch_add(1, std::memory_order_relaxed);
+	link(command);
+}
+
+
+// Puts command behind the last one. The exchange orders the producers; the command is reachable
+// once the one before links to it.
+void CommandQueue::link(Command *command) {
+	command->next.store(nullptr, std::memory_order_relaxed);
+	Command *previous = head.exchange(command, std::memory_order_acq_rel);
+	previous->next.store(command, std::memory_order_release);
+}
+
+
+// Takes the oldest Command, which the caller owns until handing it to recycle, or nullptr if there is
+// none or the oldest is still being linked in by its producer. Only the consumer calls it.
+Command * CommandQueue::pop() {
+	Command *first = tail;
+	Command *next = first->next.load(std::memory_order_acquire);
+	// The stub keeps the queue from running empty; it is skipped, and pushed again behind the last Command.
+	if (first == &stub) {
+		if (!next) {
+			return nullptr;
+		}
+		tail = next;
+		first = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+	if (next) {
+		tail = next;
+		pending.fetch_sub(1, std::memory_order_relaxed);
+		return first;
+	}
+	// first is the last Command linked in. Unless a producer is between its exchange and its link,
+	// the stub goes behind it so first can be taken.
+	if (first != head.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+	link(&stub);
+	next = first->next.load(std::memory_order_acquire);
+	if (next) {
+		tail = next;
+		pending.fetch_sub(1, std::memory_order_relaxed);
+		return first;
+	}
+	return nullptr;
+}
+
+
+// Keeps an applied Command for make to hand out again, or deletes it if the spares are full. Drops what
+// its callback held. Only the consumer calls it, though the ring would take any number of threads.
+void CommandQueue::recycle(Command *command) {
+	command->added = nullptr;
+	size_t position = spareIn.load(std::memory_order_relaxed);
+	while (true) {
+		Spare &spare = spares[position & (Spares - 1)];
+		const size_t sequence = spare.sequence.load(std::memory_order_acquire);
+		const intptr_t lap = (intptr_t)sequence - (intptr_t)position;
+		if (lap == 0) {
+			if (spareIn.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				spare.command = command;
+				spare.sequence.store(position + 1, std::memory_order_release);
+				return;
+			}
+		} else if (lap < 0) {
+			delete command;
+			return;
+		} else {
+			position = spareIn.load(std::memory_order_relaxed);
+		}
+	}
+}
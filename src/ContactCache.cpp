@@ -0,0 +1,75 @@
+// Contains member functions of the ContactCache struct.
+// Contacts between touching Joints, kept across updates for warm starting.
+#include "../include/ContactCache.hpp"
+#include "../include/JointStore.hpp"
+#include "../include/PairBatches.hpp"
+#include <algorithm>
+#include <math.h>
+
+
+// Sets up a contact for each touching pair of Joints in pairs. Pairs approaching faster than restSpeed
+// bounce apart with the product of their elasticities; slower ones come to rest against each other.
+// A contact between Joints that also touched in the last update counts as a hit, and with warmStart
+// starts from the impulse it ended that update with.
+void ContactCache::build(const std::vector<std::pair<uint32_t, uint32_t>> &pairs, const JointStore &joints, float restSpeed, bool warmStart) {
+	const size_t count = pairs.size();
+	nx.assign(count, 0);
+	ny.assign(count, 0);
+	mass.assign(count, 0);
+	bounce.assign(count, 0);
+	impulse.assign(count, 0);
+	keys.resize(count);
+	contacts = 0;
+	hits = 0;
+	for (size_t i = 0; i < count; i++) {
+		const uint32_t a = pairs[i].first;
+		const uint32_t b = pairs[i].second;
+		if (a == PairBatches::None || b == PairBatches::None) {
+			continue;
+		}
+		float dx = joints.x[a] - joints.x[b];
+		float dy = joints.y[a] - joints.y[b];
+		float reach = joints.size[a] + joints.size[b];
+		float distanceSquared = dx * dx + dy * dy;
+		if (distanceSquared >= reach * reach) {
+			continue;
+		}
+		float distance = sqrt(distanceSquared);
+		nx[i] = 1;
+		if (distance > 0) {
+			nx[i] = dx / distance;
+			ny[i] = dy / distance;
+		}
+		mass[i] = joints.mass[a] * joints.mass[b] / (joints.mass[a] + joints.mass[b]);
+		float approach = (joints.vx[b] - joints.vx[a]) * nx[i] + (joints.vy[b] - joints.vy[a]) * ny[i];
+		if (approach > restSpeed) {
+			bounce[i] = approach * joints.elasticity[a] * joints.elasticity[b];
+		}
+		keys[i] = getKey(joints.id[a], joints.id[b]);
+		contacts++;
+		auto found = std::lower_bound(previous.begin(), previous.end(), keys[i], [](const std::pair<uint64_t, float> &entry, uint64_t key) {
+			return entry.first < key;
+		});
+		if (found != previous.end() && found->first == keys[i]) {
+			hits++;
+			if (warmStart) {
+				impulse[i] = found->second;
+			}
+		}
+	}
+}
+
+
+// Keeps the impulses of this update's contacts for the next update, forgetting pairs that no longer touch.
+void ContactCache::keep() {
+	current.clear();
+	for (size_t i = 0; i < mass.size(); i++) {
+		if (mass[i] > 0) {
+			current.emplace_back(keys[i], impulse[i]);
+		}
+	}
+	std::sort(current.begin(), current.end(), [](const std::pair<uint64_t, float> &a, const std::pair<uint64_t, float> &b) {
+		return a.first < b.first;
+	});
+	previous.swap(current);
+}
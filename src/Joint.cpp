@@ -11,100 +11,174 @@ Vector operator+(Vector const& v1, Vector const& v2) {
 }
 
 
-// Joint constructor.
+// Joint constructor for a free-standing Joint.
 Joint::Joint(float x, float y, float size, float mass, float speed, float angle, float elasticity, float drag):
-x(x), y(y), size(size), mass(mass), speed(speed), angle(angle), elasticity(elasticity), drag(drag) {
+ownStore(new JointStore()) {
+	store = ownStore.get();
+	index = store->add(this, x, y, size, mass, speed, angle, elasticity, drag);
+}
+
+
+// Joint constructor for a handle to an existing slot of a store.
+Joint::Joint(JointStore *store, size_t index):
+store(store), index(index) {
+}
+
+
+// Returns the direction of the Joint's velocity, or 0 for a Joint at rest.
+float Joint::getAngle() {
+	float vx = store->vx[index];
+	float vy = store->vy[index];
+	if (vx == 0 && vy == 0) {
+		return 0;
+	}
+	return atan2(vx, -vy);
+}
+
+
+// Points the velocity of the Joint along angle a, keeping its speed.
+void Joint::setAngle(float a) {
+	float speed = getSpeed();
+	store->vx[index] = sin(a) * speed;
+	store->vy[index] = -cos(a) * speed;
+	store->requestWake(index);
+}
+
+
+// Sets the speed of the Joint, keeping its direction. A Joint at rest starts moving at angle 0.
+void Joint::setSpeed(float s) {
+	float speed = getSpeed();
+	store->requestWake(index);
+	if (speed == 0) {
+		store->vx[index] = 0;
+		store->vy[index] = -s;
+		return;
+	}
+	store->vx[index] *= s / speed;
+	store->vy[index] *= s / speed;
 }
 
 
 // Accelerates the Joint.
 void Joint::accelerate(Vector vector) {
-	Vector velocity = Vector{angle, speed} + vector;
-	angle = velocity.angle;
-	speed = velocity.speed;
+	accelerate(sin(vector.angle) * vector.speed, -cos(vector.angle) * vector.speed);
+}
+
+
+// Accelerates the Joint by a change in velocity (dvx, dvy).
+void Joint::accelerate(float dvx, float dvy) {
+	store->vx[index] += dvx;
+	store->vy[index] += dvy;
+	store->requestWake(index);
 }
 
 
 // Attracts another Joint to the Joint.
 void Joint::attract(Joint *otherP) {
-	float dx = x - otherP->x;
-	float dy = y - otherP->y;
-	float distance = hypot(dx, dy);
-	float theta = atan2(dy, dx);
-	float force = 0.2 * mass * otherP->mass / pow(distance, 2);
-	accelerate(Vector {static_cast<float>(theta - 0.5 * M_PI), force / mass});
-	otherP->accelerate(Vector {static_cast<float>(theta + 0.5 * M_PI), force/otherP->mass});
+	float dx = getX() - otherP->getX();
+	float dy = getY() - otherP->getY();
+	float distanceSquared = dx * dx + dy * dy;
+	// Force 0.2 * mass * otherMass / distance^2 along the unit vector (dx, dy) / distance.
+	float scale = 0.2f / (distanceSquared * sqrt(distanceSquared));
+	float towardsThis = scale * getMass();
+	float towardsOther = scale * otherP->getMass();
+	accelerate(-dx * towardsOther, -dy * towardsOther);
+	otherP->accelerate(dx * towardsThis, dy * towardsThis);
 }
 
 
 // Collides the Joint with another Joint.
 void Joint::checkCollide(Joint *otherP) {
-	float dx = x - otherP->x;
-	float dy = y - otherP->y;
-	float distance = hypot(dx, dy);
-	if (x+size+otherP->getSize() > otherP->getX()&&x<otherP->getX()+size+otherP->getSize()&&y+size+otherP->getSize()>otherP->getY()&&y<otherP->getY()+size+otherP->getSize())
-	if (distance < (size + otherP->size)) {	// Collision detected.
-		float tangent = atan2(dy, dx);
-		float newAngle = 0.5f * M_PI + tangent;
-		float totalMass = mass + otherP->mass;
-			
-		Vector v1 = Vector{angle, speed * (mass - otherP->mass) / totalMass} + Vector{newAngle, 2 * otherP->speed * otherP->mass / totalMass};
-		Vector v2 = Vector{otherP->angle, otherP->speed * (otherP->mass - mass) / totalMass} + Vector{static_cast<float>(newAngle+M_PI), 2 * speed * mass / totalMass};
-		
-		angle = v1.angle;
-		speed = v1.speed;
-		otherP->angle = v2.angle;
-		otherP->speed = v2.speed;
+	collide(store, index, otherP->store, otherP->index);
+}
+
+
+// Collides slot index of store with slot o of other, without going through their handles.
+// Returns whether the two touched.
+bool Joint::collide(JointStore *store, size_t index, JointStore *other, size_t o) {
+	float &x = store->x[index], &y = store->y[index];
+	float &vx = store->vx[index], &vy = store->vy[index];
+	float size = store->size[index], mass = store->mass[index];
+	float &otherX = other->x[o], &otherY = other->y[o];
+	float &otherVx = other->vx[o], &otherVy = other->vy[o];
+	float otherSize = other->size[o], otherMass = other->mass[o];
+
+	float dx = x - otherX;
+	float dy = y - otherY;
+	if (x+size+otherSize > otherX&&x<otherX+size+otherSize&&y+size+otherSize>otherY&&y<otherY+size+otherSize)
+	if (dx * dx + dy * dy < (size + otherSize) * (size + otherSize)) {	// Collision detected.
+		float distance = sqrt(dx * dx + dy * dy);
+		// Unit normal pointing from the other Joint towards this one.
+		float nx = 1, ny = 0;
+		if (distance > 0) {
+			nx = dx / distance;
+			ny = dy / distance;
+		}
+		float totalMass = mass + otherMass;
+		float speed = hypot(vx, vy);
+		float otherSpeed = hypot(otherVx, otherVy);
+		float newElasticity = store->elasticity[index] * other->elasticity[o];
 		
-		float newElasticity = elasticity * otherP->elasticity;
-		speed *= newElasticity;
-		otherP->speed *= newElasticity;
+		float keep = (mass - otherMass) / totalMass;
+		float push = 2 * otherSpeed * otherMass / totalMass;
+		float otherPush = 2 * speed * mass / totalMass;
+		vx = (vx * keep + nx * push) * newElasticity;
+		vy = (vy * keep + ny * push) * newElasticity;
+		otherVx = (otherVx * -keep - nx * otherPush) * newElasticity;
+		otherVy = (otherVy * -keep - ny * otherPush) * newElasticity;
 		
-		float overlap = 0.5f * (size + otherP->size - distance + 0.1f);
-		x += sin(newAngle) * overlap;
-		y -= cos(newAngle) * overlap;
-		otherP->x -= sin(newAngle) * overlap;
-		otherP->y += cos(newAngle) * overlap;
+		float overlap = 0.5f * (size + otherSize - distance + 0.1f);
+		x += nx * overlap;
+		y += ny * overlap;
+		otherX -= nx * overlap;
+		otherY -= ny * overlap;
+		return true;
 	}
+	return false;
 }
 
 
 // Combines the Joint with another Joint.
 void Joint::combine(Joint *otherP) {
-	float dx = x - otherP->x;
-	float dy = y - otherP->y;
-	float distance = hypot(dx, dy);
+	JointStore *other = otherP->store;
+	size_t o = otherP->index;
+	float &x = store->x[index], &y = store->y[index];
+	float &vx = store->vx[index], &vy = store->vy[index];
+	float &mass = store->mass[index];
+	float otherMass = other->mass[o];
+
+	float dx = x - other->x[o];
+	float dy = y - other->y[o];
+	float reach = store->size[index] + other->size[o];
 	
-	if (distance < (size + otherP->size)) {	// Collision detected.
-		float totalMass = mass + otherP->mass;
-		x = (x * mass + otherP->x * otherP->mass) / totalMass;
-		y = (y * mass + otherP->y * otherP->mass) / totalMass;
-		Vector vector = Vector{angle, speed * mass / totalMass} + Vector{otherP->angle, otherP->speed * otherP->mass / totalMass};
-		angle = vector.angle;
-		speed = vector.speed * (elasticity * otherP->elasticity);
-		mass += otherP->mass;
-		collideWith = otherP;
+	if (dx * dx + dy * dy < reach * reach) {	// Collision detected.
+		float totalMass = mass + otherMass;
+		float newElasticity = store->elasticity[index] * other->elasticity[o];
+		x = (x * mass + other->x[o] * otherMass) / totalMass;
+		y = (y * mass + other->y[o] * otherMass) / totalMass;
+		vx = (vx * mass + other->vx[o] * otherMass) / totalMass * newElasticity;
+		vy = (vy * mass + other->vy[o] * otherMass) / totalMass * newElasticity;
+		mass += otherMass;
+		store->collideWith[index] = otherP;
 	}
 }
 
 
 // Affects the speed of the Joint with drag.
 void Joint::experienceDrag() {
-	speed *= drag;
+	store->vx[index] *= store->drag[index];
+	store->vy[index] *= store->drag[index];
 }
 
 
 // Updates the position of the Joint.
 void Joint::move() {
-	x += sin(angle) * speed;
-	y -= cos(angle) * speed;
+	store->x[index] += store->vx[index];
+	store->y[index] += store->vy[index];
 }
 
 
 // Moves the Joint to coordinates (x, y).
 void Joint::moveTo(float moveX, float moveY) {
-	float dx = moveX - x;
-	float dy = moveY - y;
-	angle = atan2(dy, dx) + 0.5 * M_PI;
-	speed = hypot(dx, dy) * 0.1;
+	setVelocity((moveX - getX()) * 0.1f, (moveY - getY()) * 0.1f);
 }
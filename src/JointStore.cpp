@@ -0,0 +1,146 @@
+// Contains member functions of the JointStore struct.
+// Structure-of-arrays storage for Joint attributes.
+#include "../include/JointStore.hpp"
+#include "../include/Joint.hpp"
+
+const uint32_t JointStore::Awake;
+
+
+// Appends a slot for the handle and returns its index.
+size_t JointStore::add(Joint *handle, float x, float y, float size, float mass, float speed, float angle, float elasticity, float drag) {
+	this->x.push_back(x);
+	this->y.push_back(y);
+	vx.push_back(sin(angle) * speed);
+	vy.push_back(-cos(angle) * speed);
+	ax.push_back(0);
+	ay.push_back(0);
+	this->size.push_back(size);
+	this->mass.push_back(mass);
+	this->drag.push_back(drag);
+	this->elasticity.push_back(elasticity);
+	collideWith.push_back(nullptr);
+	handles.push_back(handle);
+	island.push_back(Awake);
+	restFrames.push_back(0);
+	level.push_back(0);
+	id.push_back(nextId++);
+	return handles.size() - 1;
+}
+
+
+// Rearranges one array so that slot i holds what slot order[i] held.
+template <typename T>
+static void permuteArray(std::vector<T> &values, const std::vector<uint32_t> &order) {
+	std::vector<T> moved(values.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		moved[i] = values[order[i]];
+	}
+	values.swap(moved);
+}
+
+
+// Rearranges every slot so that slot i holds what slot order[i] held, and updates the handles.
+void JointStore::permute(const std::vector<uint32_t> &order) {
+	permuteArray(x, order);
+	permuteArray(y, order);
+	permuteArray(vx, order);
+	permuteArray(vy, order);
+	permuteArray(ax, order);
+	permuteArray(ay, order);
+	permuteArray(size, order);
+	permuteArray(mass, order);
+	permuteArray(drag, order);
+	permuteArray(elasticity, order);
+	permuteArray(collideWith, order);
+	permuteArray(handles, order);
+	permuteArray(island, order);
+	permuteArray(restFrames, order);
+	permuteArray(level, order);
+	permuteArray(id, order);
+	for (size_t i = 0; i < handles.size(); i++) {
+		handles[i]->index = i;
+	}
+}
+
+
+// Removes a slot by moving the last slot into its place and updating that slot's handle.
+void JointStore::remove(size_t index) {
+	const size_t last = handles.size() - 1;
+	x[index] = x[last];
+	y[index] = y[last];
+	vx[index] = vx[last];
+	vy[index] = vy[last];
+	ax[index] = ax[last];
+	ay[index] = ay[last];
+	size[index] = size[last];
+	mass[index] = mass[last];
+	drag[index] = drag[last];
+	elasticity[index] = elasticity[last];
+	collideWith[index] = collideWith[last];
+	handles[index] = handles[last];
+	handles[index]->index = index;
+	island[index] = island[last];
+	restFrames[index] = restFrames[last];
+	level[index] = level[last];
+	id[index] = id[last];
+	x.pop_back();
+	y.pop_back();
+	vx.pop_back();
+	vy.pop_back();
+	ax.pop_back();
+	ay.pop_back();
+	size.pop_back();
+	mass.pop_back();
+	drag.pop_back();
+	elasticity.pop_back();
+	collideWith.pop_back();
+	handles.pop_back();
+	island.pop_back();
+	restFrames.pop_back();
+	level.pop_back();
+	id.pop_back();
+}
+
+
+// Reserves room for n Joints in every array.
+void JointStore::reserve(size_t n) {
+	x.reserve(n);
+	y.reserve(n);
+	vx.reserve(n);
+	vy.reserve(n);
+	ax.reserve(n);
+	ay.reserve(n);
+	size.reserve(n);
+	mass.reserve(n);
+	drag.reserve(n);
+	elasticity.reserve(n);
+	collideWith.reserve(n);
+	handles.reserve(n);
+	island.reserve(n);
+	restFrames.reserve(n);
+	level.reserve(n);
+	id.reserve(n);
+}
+
+
+// Exchanges two slots and updates their handles.
+void JointStore::swap(size_t a, size_t b) {
+	std::swap(x[a], x[b]);
+	std::swap(y[a], y[b]);
+	std::swap(vx[a], vx[b]);
+	std::swap(vy[a], vy[b]);
+	std::swap(ax[a], ax[b]);
+	std::swap(ay[a], ay[b]);
+	std::swap(size[a], size[b]);
+	std::swap(mass[a], mass[b]);
+	std::swap(drag[a], drag[b]);
+	std::swap(elasticity[a], elasticity[b]);
+	std::swap(collideWith[a], collideWith[b]);
+	std::swap(handles[a], handles[b]);
+	std::swap(island[a], island[b]);
+	std::swap(restFrames[a], restFrames[b]);
+	std::swap(level[a], level[b]);
+	std::swap(id[a], id[b]);
+	handles[a]->index = a;
+	handles[b]->index = b;
+}
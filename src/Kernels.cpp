@@ -0,0 +1,202 @@
+// Contains the batch Joint kernels: a scalar version and an AVX2 version handling 8 Joints at a time,
+// chosen once at runtime from what the CPU supports.
+#include "../include/Kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+
+// Scalar kernels, also used for the tail of each vectorised range.
+
+static void moveScalar(float *x, float *y, float *vx, float *vy, float gx, float gy, float dt, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		vx[i] += gx;
+		vy[i] += gy;
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+	}
+}
+
+static void dragScalar(float *vx, float *vy, const float *drag, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		vx[i] *= drag[i];
+		vy[i] *= drag[i];
+	}
+}
+
+static void bounceScalar(float *x, float *y, float *vx, float *vy, const float *size, const float *elasticity, float width, float height, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		// Right or left boundary:
+		if (x[i] > width - size[i]) {
+			x[i] = 2 * (width - size[i]) - x[i];
+			vx[i] = -vx[i] * elasticity[i];
+			vy[i] *= elasticity[i];
+		} else if (x[i] < size[i]) {
+			x[i] = 2 * size[i] - x[i];
+			vx[i] = -vx[i] * elasticity[i];
+			vy[i] *= elasticity[i];
+		}
+		// Bottom or top boundary:
+		if (y[i] > height - size[i]) {
+			y[i] = 2 * (height - size[i]) - y[i];
+			vx[i] *= elasticity[i];
+			vy[i] = -vy[i] * elasticity[i];
+		} else if (y[i] < size[i]) {
+			y[i] = 2 * size[i] - y[i];
+			vx[i] *= elasticity[i];
+			vy[i] = -vy[i] * elasticity[i];
+		}
+	}
+}
+
+static void settleScalar(float *vx, float *vy, float stable, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		if (vx[i] * vx[i] + vy[i] * vy[i] < stable * stable) {
+			vx[i] = 0;
+			vy[i] = 0;
+		}
+	}
+}
+
+
+#ifdef KERNELS_X86
+// AVX2 kernels. Branches become masks, and blends pick the bounced values lane by lane.
+
+TARGET_AVX2 static void moveAVX2(float *x, float *y, float *vx, float *vy, float gx, float gy, float dt, size_t count) {
+	const __m256 gravityX = _mm256_set1_ps(gx);
+	const __m256 gravityY = _mm256_set1_ps(gy);
+	const __m256 time = _mm256_set1_ps(dt);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 velocityX = _mm256_add_ps(_mm256_loadu_ps(vx + i), gravityX);
+		__m256 velocityY = _mm256_add_ps(_mm256_loadu_ps(vy + i), gravityY);
+		_mm256_storeu_ps(vx + i, velocityX);
+		_mm256_storeu_ps(vy + i, velocityY);
+		_mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(velocityX, time)));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(velocityY, time)));
+	}
+	moveScalar(x + i, y + i, vx + i, vy + i, gx, gy, dt, count - i);
+}
+
+TARGET_AVX2 static void dragAVX2(float *vx, float *vy, const float *drag, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 d = _mm256_loadu_ps(drag + i);
+		_mm256_storeu_ps(vx + i, _mm256_mul_ps(_mm256_loadu_ps(vx + i), d));
+		_mm256_storeu_ps(vy + i, _mm256_mul_ps(_mm256_loadu_ps(vy + i), d));
+	}
+	dragScalar(vx + i, vy + i, drag + i, count - i);
+}
+
+TARGET_AVX2 static void bounceAVX2(float *x, float *y, float *vx, float *vy, const float *size, const float *elasticity, float width, float height, size_t count) {
+	const __m256 two = _mm256_set1_ps(2);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 right = _mm256_set1_ps(width);
+	const __m256 bottom = _mm256_set1_ps(height);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 velocityX = _mm256_loadu_ps(vx + i);
+		__m256 velocityY = _mm256_loadu_ps(vy + i);
+		__m256 s = _mm256_loadu_ps(size + i);
+		__m256 e = _mm256_loadu_ps(elasticity + i);
+		
+		// Right or left boundary:
+		__m256 limit = _mm256_sub_ps(right, s);
+		__m256 hitRight = _mm256_cmp_ps(px, limit, _CMP_GT_OQ);
+		__m256 hitLeft = _mm256_andnot_ps(hitRight, _mm256_cmp_ps(px, s, _CMP_LT_OQ));
+		__m256 hit = _mm256_or_ps(hitRight, hitLeft);
+		px = _mm256_blendv_ps(px, _mm256_sub_ps(_mm256_mul_ps(two, limit), px), hitRight);
+		px = _mm256_blendv_ps(px, _mm256_sub_ps(_mm256_mul_ps(two, s), px), hitLeft);
+		velocityX = _mm256_blendv_ps(velocityX, _mm256_mul_ps(_mm256_xor_ps(velocityX, sign), e), hit);
+		velocityY = _mm256_blendv_ps(velocityY, _mm256_mul_ps(velocityY, e), hit);
+		
+		// Bottom or top boundary:
+		limit = _mm256_sub_ps(bottom, s);
+		__m256 hitBottom = _mm256_cmp_ps(py, limit, _CMP_GT_OQ);
+		__m256 hitTop = _mm256_andnot_ps(hitBottom, _mm256_cmp_ps(py, s, _CMP_LT_OQ));
+		hit = _mm256_or_ps(hitBottom, hitTop);
+		py = _mm256_blendv_ps(py, _mm256_sub_ps(_mm256_mul_ps(two, limit), py), hitBottom);
+		py = _mm256_blendv_ps(py, _mm256_sub_ps(_mm256_mul_ps(two, s), py), hitTop);
+		velocityX = _mm256_blendv_ps(velocityX, _mm256_mul_ps(velocityX, e), hit);
+		velocityY = _mm256_blendv_ps(velocityY, _mm256_mul_ps(_mm256_xor_ps(velocityY, sign), e), hit);
+		
+		_mm256_storeu_ps(x + i, px);
+		_mm256_storeu_ps(y + i, py);
+		_mm256_storeu_ps(vx + i, velocityX);
+		_mm256_storeu_ps(vy + i, velocityY);
+	}
+	bounceScalar(x + i, y + i, vx + i, vy + i, size + i, elasticity + i, width, height, count - i);
+}
+
+TARGET_AVX2 static void settleAVX2(float *vx, float *vy, float stable, size_t count) {
+	const __m256 limit = _mm256_set1_ps(stable * stable);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 velocityX = _mm256_loadu_ps(vx + i);
+		__m256 velocityY = _mm256_loadu_ps(vy + i);
+		__m256 speedSquared = _mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY));
+		__m256 moving = _mm256_cmp_ps(speedSquared, limit, _CMP_NLT_UQ);
+		_mm256_storeu_ps(vx + i, _mm256_and_ps(velocityX, moving));
+		_mm256_storeu_ps(vy + i, _mm256_and_ps(velocityY, moving));
+	}
+	settleScalar(vx + i, vy + i, stable, count - i);
+}
+
+
+// Returns whether the CPU and operating system support AVX2.
+static bool hasAVX2() {
+#if defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+#endif // KERNELS_X86
+
+
+// Returns the scalar kernels.
+const Kernels &getScalarKernels() {
+	static const Kernels scalar = {"scalar", moveScalar, dragScalar, bounceScalar, settleScalar};
+	return scalar;
+}
+
+
+// Returns the fastest kernels the CPU supports, chosen on first use.
+const Kernels &getKernels() {
+#ifdef KERNELS_X86
+	static const Kernels avx2 = {"avx2", moveAVX2, dragAVX2, bounceAVX2, settleAVX2};
+	static const bool useAVX2 = hasAVX2();
+	if (useAVX2) {
+		return avx2;
+	}
+#endif
+	return getScalarKernels();
+}
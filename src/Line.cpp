@@ -4,7 +4,8 @@ Line::Line(float StartX, float StartY, float EndX, float EndY, float LineWidth):
 StartX(StartX), StartY(StartY), EndX(EndX), EndY(EndY), width(LineWidth){
 }
 
-void Line::checkCollide(Joint *P){
+// Bounces the Joint off the Line if they touch, and returns whether they did.
+bool Line::checkCollide(Joint *P){
     float LineX1 = EndX - StartX;
 	float LineY1 = EndY - StartY;
 
@@ -28,19 +29,84 @@ void Line::checkCollide(Joint *P){
             // Displace Current Ball away from collision
             float dx = ClosestPointX - P->getX();
             float dy = ClosestPointY - P->getY();
-            float distance = hypot(dx, dy);
-            float tangent = atan2(dy, dx);
-            float newAngle = 0.5f * M_PI + tangent;
+            float distance = sqrtf(dx * dx + dy * dy);
+            // Unit normal pointing from the line towards the ball
+            float nx = -1, ny = 0;
+            if (distance > 0) {
+                nx = -dx / distance;
+                ny = -dy / distance;
+            }
             float Overlap = 1.0f * (width + P->getSize() - distance + 1);
-            P->setAngle(newAngle - M_PI);
-            P->setSpeed(P->getSpeed() * P->getElasticity());
+            float speed = P->getSpeed() * P->getElasticity();
+            P->setVelocity(nx * speed, ny * speed);
 
-            P->setX(P->getX() - sin(newAngle) * Overlap);
-            P->setY(P->getY() + cos(newAngle) * Overlap);
+            P->setX(P->getX() + nx * Overlap);
+            P->setY(P->getY() + ny * Overlap);
 
             
             //P->setX( P->getX() - Overlap * (P->getX() - ClosestPointX) / Distance);
             //P->setY( P->getY() - Overlap * (P->getY() - ClosestPointY) / Distance);
+            return true;
         }
     }
-}
\ No newline at end of file
+    return false;
+}
+
+// Sweeps a circle of the given radius from (fromX, fromY) to (toX, toY) against the Line and returns the
+// share of the move after which it first touches, or INFINITY if it misses or already touches at the start,
+// which checkCollide handles. On a hit, (nx, ny) is the unit normal from the Line towards the circle.
+float Line::sweep(float fromX, float fromY, float toX, float toY, float radius, float &nx, float &ny){
+    float reach = radius + width;
+    float LineX = EndX - StartX;
+	float LineY = EndY - StartY;
+    float MoveX = toX - fromX;
+	float MoveY = toY - fromY;
+    float EdgeLength = LineX * LineX + LineY * LineY;
+
+    float t = EdgeLength > 0 ? std::max(0.0f, std::min(EdgeLength, LineX * (fromX - StartX) + LineY * (fromY - StartY))) / EdgeLength : 0;
+    float dx = fromX - StartX - t * LineX;
+    float dy = fromY - StartY - t * LineY;
+    if (dx * dx + dy * dy <= reach * reach) {
+        return INFINITY;
+    }
+
+    float toi = INFINITY;
+    // The sides: the move crosses the parallel at distance reach on the side it starts from,
+    // touching there if it is still alongside the Line.
+    if (EdgeLength > 0) {
+        float length = sqrtf(EdgeLength);
+        float ux = LineX / length, uy = LineY / length;
+        float from = (fromX - StartX) * -uy + (fromY - StartY) * ux;
+        float to = (toX - StartX) * -uy + (toY - StartY) * ux;
+        float side = from >= 0 ? 1 : -1;
+        if (side * from > reach && side * to < reach) {
+            float s = (side * from - reach) / (side * (from - to));
+            float along = (fromX + s * MoveX - StartX) * ux + (fromY + s * MoveY - StartY) * uy;
+            if (along >= 0 && along <= length) {
+                toi = s;
+                nx = -uy * side;
+                ny = ux * side;
+            }
+        }
+    }
+    // The rounded ends, where the move reaches within reach of either end point.
+    float a = MoveX * MoveX + MoveY * MoveY;
+    const float ends[2][2] = {{StartX, StartY}, {EndX, EndY}};
+    for (const float *end : ends) {
+        float fx = fromX - end[0];
+        float fy = fromY - end[1];
+        float b = fx * MoveX + fy * MoveY;
+        float c = fx * fx + fy * fy - reach * reach;
+        float discriminant = b * b - a * c;
+        if (c <= 0 || b >= 0 || discriminant < 0) {
+            continue;
+        }
+        float s = (-b - sqrtf(discriminant)) / a;
+        if (s < toi) {
+            toi = s;
+            nx = (fx + s * MoveX) / reach;
+            ny = (fy + s * MoveY) / reach;
+        }
+    }
+    return toi <= 1 ? toi : INFINITY;
+}
@@ -0,0 +1,55 @@
+#include "../include/LineBVH.hpp"
+
+// Builds the hierarchy over the provided boundaries, replacing any previous one
+void LineBVH::build(const std::vector<Rect> &bounds) {
+    nodes.clear();
+    itemBounds = bounds;
+    items.resize(bounds.size());
+    for (unsigned i = 0; i < items.size(); ++i)
+        items[i] = i;
+    if (items.empty()) return;
+    nodes.reserve(2 * (items.size() / LeafSize + 1));
+    nodes.push_back({});
+    split(0, 0, (unsigned)items.size());
+}
+
+// Returns total node count for this hierarchy
+unsigned LineBVH::totalNodes() const noexcept {
+    return (unsigned)nodes.size();
+}
+
+// Bounds a node over items first to first + count - 1, then halves it at the median of its longest axis
+void LineBVH::split(unsigned node, unsigned first, unsigned count) {
+    double left = itemBounds[items[first]].x, top = itemBounds[items[first]].y;
+    double right = left + itemBounds[items[first]].width, bottom = top + itemBounds[items[first]].height;
+    for (unsigned i = first + 1; i < first + count; ++i) {
+        const Rect &b = itemBounds[items[i]];
+        left   = std::min(left, b.x);
+        top    = std::min(top, b.y);
+        right  = std::max(right, b.x + b.width);
+        bottom = std::max(bottom, b.y + b.height);
+    }
+    nodes[node].bound = Rect(left, top, right - left, bottom - top);
+    if (count <= LeafSize) {
+        nodes[node].first = first;
+        nodes[node].count = count;
+        return;
+    }
+
+    // Median split by centre along the longest axis
+    bool alongX = right - left >= bottom - top;
+    unsigned half = count / 2;
+    std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+        [&](unsigned a, unsigned b) {
+            const Rect &ra = itemBounds[a], &rb = itemBounds[b];
+            return alongX ? ra.x * 2 + ra.width < rb.x * 2 + rb.width
+                          : ra.y * 2 + ra.height < rb.y * 2 + rb.height;
+        });
+    unsigned child = (unsigned)nodes.size();
+    nodes[node].first = child;
+    nodes[node].count = 0;
+    nodes.push_back({});
+    nodes.push_back({});
+    split(child, first, half);
+    split(child + 1, first + half, count - half);
+}
@@ -0,0 +1,243 @@
+#include "../include/LinearQuadTree.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Spreads the bits of a cell coordinate apart, so two coordinates interleave into a Morton code
+static inline uint64_t spreadBits(uint32_t v) noexcept {
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8))  & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2))  & 0x3333333333333333ull;
+    x = (x | (x << 1))  & 0x5555555555555555ull;
+    return x;
+}
+
+LinearQuadTree::LinearQuadTree(const Rect &_bound, unsigned _maxLevel) :
+    bounds(_bound),
+    maxLevel(_maxLevel < MaxLevel ? _maxLevel : MaxLevel) {
+    columnScale = (1u << maxLevel) / bounds.width;
+    rowScale = (1u << maxLevel) / bounds.height;
+}
+
+// Returns the full-depth cells (left, top, right, bottom) covered by the provided boundary
+void LinearQuadTree::getRange(const Rect &bound, unsigned range[4]) const noexcept {
+    range[0] = getCell(bound.x - bounds.x, columnScale);
+    range[1] = getCell(bound.y - bounds.y, rowScale);
+    range[2] = getCell(bound.x + bound.width - bounds.x, columnScale);
+    range[3] = getCell(bound.y + bound.height - bounds.y, rowScale);
+}
+
+// Calls visit(index) for the sorted entries of the node at (column, row, level) and of its branch,
+// held in entries [first, last). The node meets range; its children are skipped where they do not
+template <typename Visit>
+void LinearQuadTree::visitBranch(unsigned column, unsigned row, unsigned level, size_t first, size_t last,
+                                 const unsigned range[4], Visit &&visit) const {
+    // The node's own objects lead its run
+    unsigned shift = maxLevel - level;
+    uint64_t code = (spreadBits(column) | spreadBits(row) << 1) << (2 * shift);
+    uint64_t ownKey = code << LevelBits | level;
+    for (; first < last && entries[first].key == ownKey; ++first)
+        visit(first);
+    if (level == maxLevel) return;
+    // Visiting a short run outright is cheaper than searching it
+    if (last - first <= ScanLimit) {
+        for (; first < last; ++first)
+            visit(first);
+        return;
+    }
+
+    // Children follow in Morton order, each a run of a quarter of the codes. Only children whose
+    // cells meet the range are searched for
+    uint64_t childSpan = 1ull << (2 * (shift - 1));
+    for (unsigned child = 0; child < 4 && first < last; ++child) {
+        unsigned childColumn = column * 2 + (child & 1);
+        unsigned childRow = row * 2 + (child >> 1);
+        if ((childColumn << (shift - 1)) > range[2] || ((childColumn + 1) << (shift - 1)) - 1 < range[0]) continue;
+        if ((childRow << (shift - 1)) > range[3] || ((childRow + 1) << (shift - 1)) - 1 < range[1]) continue;
+        size_t childFirst = getBranchEnd(first, last, code + child * childSpan);
+        size_t childLast = getBranchEnd(childFirst, last, code + (child + 1) * childSpan);
+        if (childFirst < childLast)
+            visitBranch(childColumn, childRow, level + 1, childFirst, childLast, range, visit);
+        first = childLast;
+    }
+}
+
+// Sorts the objects by the node that holds them: the smallest node whose cells cover the object
+void LinearQuadTree::build(const std::vector<Collidable*> &objs, ThreadPool *pool) {
+    const size_t count = objs.size();
+    entries.resize(count);
+    sortBuffer.resize(count);
+    forBlocks(count, pool, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            entries[i] = { getKey(objs[i]->bound), objs[i] };
+    });
+
+    // Least significant digit radix sort, one byte per pass
+    const size_t blocks = (count + BlockSize - 1) / BlockSize;
+    blockCounts.resize(blocks * 256);
+    for (unsigned shift = 0; shift < 2 * maxLevel + LevelBits; shift += 8) {
+        forBlocks(count, pool, [&](size_t block, size_t begin, size_t end) {
+            unsigned *counts = &blockCounts[block * 256];
+            std::fill(counts, counts + 256, 0);
+            for (size_t i = begin; i < end; ++i)
+                ++counts[(entries[i].key >> shift) & 255];
+        });
+        // Each block writes after the same digit of earlier blocks, which keeps the sort stable
+        unsigned offset = 0;
+        for (unsigned digit = 0; digit < 256; ++digit) {
+            for (size_t block = 0; block < blocks; ++block) {
+                unsigned digitCount = blockCounts[block * 256 + digit];
+                blockCounts[block * 256 + digit] = offset;
+                offset += digitCount;
+            }
+        }
+        forBlocks(count, pool, [&](size_t block, size_t begin, size_t end) {
+            unsigned *offsets = &blockCounts[block * 256];
+            for (size_t i = begin; i < end; ++i)
+                sortBuffer[offsets[(entries[i].key >> shift) & 255]++] = entries[i];
+        });
+        entries.swap(sortBuffer);
+    }
+
+    // Copy the boundaries and their cells into sorted order, so searches read memory in sequence
+    sortedBounds.resize(count);
+    sortedCells.resize(count);
+    forBlocks(count, pool, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            sortedBounds[i] = entries[i].obj->bound;
+            unsigned range[4];
+            getRange(sortedBounds[i], range);
+            sortedCells[i] = { (uint16_t)range[0], (uint16_t)range[1], (uint16_t)range[2], (uint16_t)range[3] };
+        }
+    });
+}
+
+// Searches the nodes around the provided boundary for objects within it and appends them to the caller's vector
+void LinearQuadTree::getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const {
+    if (entries.empty()) return;
+    unsigned range[4];
+    getRange(bound, range);
+    visitBranch(0, 0, 0, 0, entries.size(), range, [&](size_t index) {
+        Collidable *obj = entries[index].obj;
+        // Only check for intersection with OTHER boundaries
+        if (&obj->bound != &bound && sortedBounds[index].intersects(bound))
+            found.push_back(obj);
+    });
+}
+
+// Appends every pair of objects whose boundaries intersect, each pair exactly once.
+// Intersecting objects sit in the same node or one in an ancestor of the other's, so walking the
+// objects in order, each only meets the earlier objects on its path that reach its node.
+void LinearQuadTree::getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs, ThreadPool *pool) {
+    const size_t count = entries.size();
+    const size_t blocks = (count + BlockSize - 1) / BlockSize;
+    if (blockPairs.size() < blocks) blockPairs.resize(blocks);
+    if (blockPaths.size() < blocks * (MaxLevel + 1)) blockPaths.resize(blocks * (MaxLevel + 1));
+    forBlocks(count, pool, [&](size_t block, size_t begin, size_t end) {
+        std::vector<std::pair<Collidable*, Collidable*>> &found = blockPairs[block];
+        found.clear();
+        // reaching[level] holds the objects of the path down to that level whose cells meet the node there
+        std::vector<uint32_t> *reaching = &blockPaths[block * (MaxLevel + 1)];
+        uint64_t path[MaxLevel + 1];
+        unsigned depth = 0;
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t code = entries[i].key >> LevelBits;
+            unsigned level = entries[i].key & ((1u << LevelBits) - 1);
+            const Cells &cells = sortedCells[i];
+
+            // Keep the part of the path shared with the previous object and rebuild the rest
+            unsigned shared = 0;
+            while (shared < depth && shared <= level && path[shared] == getAncestorKey(code, shared))
+                ++shared;
+            for (unsigned l = shared; l <= level; ++l) {
+                path[l] = getAncestorKey(code, l);
+                reaching[l].clear();
+                if (l > 0) {
+                    unsigned shift = maxLevel - l;
+                    unsigned left = cells.left >> shift << shift, right = left + (1u << shift) - 1;
+                    unsigned top  = cells.top  >> shift << shift, bottom = top + (1u << shift) - 1;
+                    for (uint32_t j : reaching[l - 1]) {
+                        const Cells &other = sortedCells[j];
+                        if (other.left <= right && other.right >= left && other.top <= bottom && other.bottom >= top)
+                            reaching[l].push_back(j);
+                    }
+                }
+                // The first object of a block also meets objects of its path sorted into earlier blocks
+                if (i == begin) {
+                    size_t j = std::lower_bound(entries.begin(), entries.begin() + begin, path[l],
+                        [](const Entry &entry, uint64_t key) { return entry.key < key; }) - entries.begin();
+                    for (; j < begin && entries[j].key == path[l]; ++j)
+                        reaching[l].push_back((uint32_t)j);
+                }
+            }
+            depth = level + 1;
+
+            const Rect &bound = sortedBounds[i];
+            for (uint32_t j : reaching[level]) {
+                if (sortedBounds[j].intersects(bound))
+                    found.emplace_back(entries[j].obj, entries[i].obj);
+            }
+            reaching[level].push_back((uint32_t)i);
+        }
+    });
+    for (size_t block = 0; block < blocks; ++block)
+        pairs.insert(pairs.end(), blockPairs[block].begin(), blockPairs[block].end());
+}
+
+// Returns total object count for this quadtree
+unsigned LinearQuadTree::totalObjects() const noexcept {
+    return (unsigned)entries.size();
+}
+
+// Returns the sort key of the node holding the provided boundary
+uint64_t LinearQuadTree::getKey(const Rect &bound) const noexcept {
+    unsigned range[4];
+    getRange(bound, range);
+    uint64_t first = spreadBits(range[0]) | spreadBits(range[1]) << 1;
+    uint64_t last  = spreadBits(range[2]) | spreadBits(range[3]) << 1;
+    // The codes of the corner cells agree down to the level of the smallest node covering both
+    unsigned levelsUp = 0;
+    for (uint64_t diff = first ^ last; diff != 0; diff >>= 2)
+        ++levelsUp;
+    uint64_t code = first & ~((1ull << (2 * levelsUp)) - 1);
+    return code << LevelBits | (maxLevel - levelsUp);
+}
+
+// Returns the sort key of the ancestor at the provided level of the node with the provided code
+uint64_t LinearQuadTree::getAncestorKey(uint64_t code, unsigned level) const noexcept {
+    unsigned shift = 2 * (maxLevel - level);
+    return (code >> shift << shift) << LevelBits | level;
+}
+
+// Returns the column (or row) of the full-depth cell at an offset from the edge, clamped to the tree
+unsigned LinearQuadTree::getCell(double offset, double scale) const noexcept {
+    double cell = std::floor(offset * scale);
+    if (!(cell > 0)) return 0;
+    if (cell >= (double)(1u << maxLevel)) return (1u << maxLevel) - 1;
+    return (unsigned)cell;
+}
+
+// Returns the first entry in [first, last) whose node code is at or past the provided code.
+// Runs are usually short, so the search gallops forward from first before bisecting.
+size_t LinearQuadTree::getBranchEnd(size_t first, size_t last, uint64_t code) const noexcept {
+    const uint64_t key = code << LevelBits;
+    size_t step = 1;
+    while (first + step < last && entries[first + step].key < key) {
+        first += step;
+        step *= 2;
+    }
+    last = std::min(last, first + step + 1);
+    return std::lower_bound(entries.begin() + first, entries.begin() + last, key,
+        [](const Entry &entry, uint64_t key) { return entry.key < key; }) - entries.begin();
+}
+
+// Runs task over fixed blocks of count items, spread over the pool's workers when provided
+void LinearQuadTree::forBlocks(size_t count, ThreadPool *pool, const std::function<void(size_t block, size_t begin, size_t end)> &task) {
+    auto run = [&](size_t begin, size_t end) {
+        for (size_t block = (begin + BlockSize - 1) / BlockSize; block * BlockSize < end; ++block)
+            task(block, block * BlockSize, std::min(count, (block + 1) * BlockSize));
+    };
+    if (pool != nullptr) pool->parallelFor(count, run);
+    else run(0, count);
+}
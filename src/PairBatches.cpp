@@ -0,0 +1,55 @@
+// Contains member functions of the PairBatches struct.
+// Groups pairs of Joint indices into batches in which no Joint appears twice.
+#include "../include/PairBatches.hpp"
+#include <algorithm>
+
+
+// Assigns each pair the first batch free for both of its Joints.
+// The first 64 batches are tracked with bit masks; a pair that finds them all taken gets a batch of its own.
+void PairBatches::build(const std::vector<std::pair<uint32_t, uint32_t>> &pairs, size_t jointCount) {
+	used.assign(jointCount, 0);
+	batchOf.resize(pairs.size());
+	uint32_t batches = 0;
+	uint32_t overflow = 64;
+	for (size_t i = 0; i < pairs.size(); i++) {
+		uint32_t a = pairs[i].first;
+		uint32_t b = pairs[i].second;
+		uint64_t taken = (a != None ? used[a] : 0) | (b != None ? used[b] : 0);
+		uint32_t batch;
+		if (~taken == 0) {
+			batch = overflow++;
+		} else {
+			batch = 0;
+			while (taken & (uint64_t(1) << batch)) {
+				batch++;
+			}
+			uint64_t bit = uint64_t(1) << batch;
+			if (a != None) {
+				used[a] |= bit;
+			}
+			if (b != None) {
+				used[b] |= bit;
+			}
+		}
+		batchOf[i] = batch;
+		batches = std::max(batches, batch + 1);
+	}
+	// Counting sort of the pairs by batch, keeping their order within each batch.
+	starts.assign(batches + 1, 0);
+	for (size_t i = 0; i < pairs.size(); i++) {
+		starts[batchOf[i] + 1]++;
+	}
+	for (size_t batch = 1; batch < starts.size(); batch++) {
+		starts[batch] += starts[batch - 1];
+	}
+	order.resize(pairs.size());
+	for (size_t i = 0; i < pairs.size(); i++) {
+		order[starts[batchOf[i]]++] = i;
+	}
+	for (size_t batch = starts.size() - 1; batch > 0; batch--) {
+		starts[batch] = starts[batch - 1];
+	}
+	if (!starts.empty()) {
+		starts[0] = 0;
+	}
+}
@@ -1,4 +1,5 @@
 #include "../include/QuadTree.hpp"
+#include <cmath>
 
 //** Rect **//
 Rect::Rect(const Rect &other) : Rect(other.x, other.y, other.width, other.height) { }
@@ -28,29 +29,55 @@ double Rect::getRight()  const noexcept { return x + (width  * 0.5f); }
 double Rect::getBottom() const noexcept { return y - (height * 0.5f); }
 
 //** Collidable **//
-Collidable::Collidable(const Rect &_bounds, std::any _data) :
+Collidable::Collidable(const Rect &_bounds, CollidableId _data) :
     bound(_bounds),
     data(_data) {
 };
 
+//** QuadTree::NodePool **//
+// Hands out nodes four siblings at a time from contiguous blocks. Released groups keep their
+// object buffers and are reused first, so a tree that has reached its working size stops allocating.
+struct QuadTree::NodePool {
+    static const unsigned GroupsPerBlock = 64;
+    std::vector<std::unique_ptr<QuadTree[]>> blocks;
+    std::vector<QuadTree*> freeGroups;
+    unsigned used = GroupsPerBlock; // Groups handed out from the last block
+
+    QuadTree *acquire() {
+        if (!freeGroups.empty()) {
+            QuadTree *group = freeGroups.back();
+            freeGroups.pop_back();
+            return group;
+        }
+        if (used == GroupsPerBlock) {
+            blocks.emplace_back(new QuadTree[4 * GroupsPerBlock]);
+            used = 0;
+        }
+        return &blocks.back()[4 * used++];
+    }
+    void release(QuadTree *group) { freeGroups.push_back(group); }
+};
+
 //** QuadTree **//
 QuadTree::QuadTree() : QuadTree({}, 0, 0) { }
-QuadTree::QuadTree(const QuadTree &other) : QuadTree(other.bounds, other.capacity, other.maxLevel) { }
+QuadTree::QuadTree(const QuadTree &other) : QuadTree(other.bounds, other.capacity, other.maxLevel) {
+    margin = other.margin;
+}
 QuadTree::QuadTree(const Rect &_bound, unsigned _capacity, unsigned _maxLevel) :
     bounds(_bound),
     capacity(_capacity),
     maxLevel(_maxLevel) {
     objects.reserve(_capacity);
-    foundObjects.reserve(_capacity);
 }
 
 // Inserts an object into this quadtree
 bool QuadTree::insert(Collidable *obj) {
     if (obj->qt != nullptr) return false;
 
+    fatten(obj);
     if (!isLeaf) {
         // insert object into leaf
-        if (QuadTree *child = getChild(obj->bound))
+        if (QuadTree *child = getChild(obj->fatBound))
             return child->insert(obj);
     }
     objects.push_back(obj);
@@ -67,6 +94,12 @@ bool QuadTree::insert(Collidable *obj) {
 // Removes an object from this quadtree
 bool QuadTree::remove(Collidable *obj) {
     if (obj->qt == nullptr) return false; // Cannot exist in vector
+    if (obj->dirty) {
+        QuadTree *root = this;
+        while (root->parent != nullptr) root = root->parent;
+        root->dirty.erase(std::find(root->dirty.begin(), root->dirty.end(), obj));
+        obj->dirty = false;
+    }
     if (obj->qt != this) return obj->qt->remove(obj);
 
     objects.erase(std::find(objects.begin(), objects.end(), obj));
@@ -77,40 +110,134 @@ bool QuadTree::remove(Collidable *obj) {
 
 // Removes and re-inserts object into quadtree (for objects that move)
 bool QuadTree::update(Collidable *obj) {
-    if (!remove(obj)) return false;
+    if (obj->qt == nullptr) return false;
+    if (obj->qt != this) return obj->qt->update(obj);
+
+    // Detach without discarding buckets, so this node stays in the tree until the object is placed again
+    objects.erase(std::find(objects.begin(), objects.end(), obj));
+    obj->qt = nullptr;
+
+    // Climb to the nearest node that still contains the object, then insert from there
+    fatten(obj);
+    QuadTree *node = this;
+    while (node->parent != nullptr && !node->bounds.contains(obj->fatBound))
+        node = node->parent;
+    node->insert(obj);
+    discardEmptyBuckets();
+    return true;
+}
+
+// Queues the object for reinsertion if its bound has left its fat bound and returns whether it was queued.
+// Objects moving within their margin keep their node, so only the queued ones cost an update
+bool QuadTree::refit(Collidable *obj) {
+    if (obj->qt == nullptr || obj->dirty || obj->fatBound.contains(obj->bound)) return false;
+    obj->dirty = true;
+    dirty.push_back(obj);
+    return true;
+}
+
+// Reinserts the objects queued by refit with fresh fat bounds
+void QuadTree::updateDirty() {
+    for (Collidable *obj : dirty) {
+        obj->dirty = false;
+        update(obj);
+    }
+    dirty.clear();
+}
 
-    // Not contained in this node -- insert into parent
-    if (parent != nullptr && !bounds.contains(obj->bound))
-        return parent->insert(obj);
+// Sets the margin added around objects' bounds when they are placed (for objects that move)
+void QuadTree::setMargin(double _margin) noexcept {
+    margin = _margin;
     if (!isLeaf) {
-        // Still within current node -- insert into leaf
-        if (QuadTree *child = getChild(obj->bound))
-            return child->insert(obj);
+        for (QuadTree *child : children)
+            child->setMargin(_margin);
     }
-    return insert(obj);
 }
 
-// Searches quadtree for objects within the provided boundary and returns them in vector
-std::vector<Collidable*> &QuadTree::getObjectsInBound(const Rect &bound) {
-    foundObjects.clear();
-    for (const auto &obj : objects) {
-        // Only check for intersection with OTHER boundaries
-        if (&obj->bound != &bound && obj->bound.intersects(bound))
-            foundObjects.push_back(obj);
+// Returns the margin added around objects' bounds
+double QuadTree::getMargin() const noexcept {
+    return margin;
+}
+
+// Appends the objects within the provided boundary to the caller's vector
+void QuadTree::getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const {
+    query(bound, [&found](Collidable *obj) { found.push_back(obj); });
+}
+
+// Appends every pair of objects whose boundaries intersect, each pair exactly once
+void QuadTree::getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs) const {
+    for (size_t i = 0; i < objects.size(); ++i) {
+        Collidable *obj = objects[i];
+        // Pairs within this node
+        for (size_t j = i + 1; j < objects.size(); ++j) {
+            if (obj->bound.intersects(objects[j]->bound))
+                pairs.emplace_back(obj, objects[j]);
+        }
+        // Pairs with objects stored further down this branch
+        if (!isLeaf) {
+            for (QuadTree *child : children)
+                child->getIntersections(obj, pairs);
+        }
+    }
+    // Siblings never overlap, so the remaining pairs live entirely within one child
+    if (!isLeaf) {
+        for (QuadTree *child : children)
+            child->getIntersectingPairs(pairs);
+    }
+}
+
+// Recomputes the total mass and centre of mass of every branch from the objects' masses
+void QuadTree::updateMass() noexcept {
+    mass = massX = massY = 0;
+    for (const Collidable *obj : objects) {
+        mass  += obj->mass;
+        massX += obj->mass * (obj->bound.x + obj->bound.width  * 0.5);
+        massY += obj->mass * (obj->bound.y + obj->bound.height * 0.5);
     }
     if (!isLeaf) {
-        // Get objects from leaves
-        if (QuadTree *child = getChild(bound)) {
-            child->getObjectsInBound(bound);
-            foundObjects.insert(foundObjects.end(), child->foundObjects.begin(), child->foundObjects.end());
-        } else for (QuadTree *leaf : children) {
-            if (leaf->bounds.intersects(bound)) {
-                leaf->getObjectsInBound(bound);
-                foundObjects.insert(foundObjects.end(), leaf->foundObjects.begin(), leaf->foundObjects.end());
-            }
+        for (QuadTree *child : children) {
+            child->updateMass();
+            mass  += child->mass;
+            massX += child->mass * child->massX;
+            massY += child->mass * child->massY;
         }
     }
-    return foundObjects;
+    if (mass > 0) {
+        massX /= mass;
+        massY /= mass;
+    }
+}
+
+// Adds the inverse-square pull of every other object on the provided one to (ax, ay), Barnes-Hut style:
+// a branch that is small compared to its distance (width / distance < theta) is treated as a single mass
+void QuadTree::getAttraction(const Collidable *obj, double theta, double &ax, double &ay) const noexcept {
+    if (mass <= 0) return;
+    double x = obj->bound.x + obj->bound.width  * 0.5;
+    double y = obj->bound.y + obj->bound.height * 0.5;
+
+    // The root and branches around the object itself are always opened, so it never pulls on itself
+    double dx = massX - x, dy = massY - y;
+    double distanceSquared = dx * dx + dy * dy;
+    if (parent != nullptr && !bounds.contains({ x, y, 0, 0 })
+        && bounds.width * bounds.width < theta * theta * distanceSquared) {
+        double scale = mass / (distanceSquared * sqrt(distanceSquared));
+        ax += dx * scale;
+        ay += dy * scale;
+        return;
+    }
+    for (const Collidable *other : objects) {
+        if (other == obj) continue;
+        dx = other->bound.x + other->bound.width  * 0.5 - x;
+        dy = other->bound.y + other->bound.height * 0.5 - y;
+        distanceSquared = dx * dx + dy * dy;
+        double scale = other->mass / (distanceSquared * sqrt(distanceSquared));
+        ax += dx * scale;
+        ay += dy * scale;
+    }
+    if (!isLeaf) {
+        for (QuadTree *child : children)
+            child->getAttraction(obj, theta, ax, ay);
+    }
 }
 
 // Returns total children count for this quadtree
@@ -134,6 +261,9 @@ unsigned QuadTree::totalObjects() const noexcept {
 
 // Removes all objects and children from this quadtree
 void QuadTree::clear() noexcept {
+    for (Collidable *obj : dirty)
+        obj->dirty = false;
+    dirty.clear();
     if (!objects.empty()) {
         for (auto&& obj : objects)
             obj->qt = nullptr;
@@ -142,12 +272,20 @@ void QuadTree::clear() noexcept {
     if (!isLeaf) {
         for (QuadTree *child : children)
             child->clear();
+        pool->release(children[0]);
+        for (QuadTree *&child : children)
+            child = nullptr;
         isLeaf = true;
     }
 }
 
 // Subdivides into four quadrants
 void QuadTree::subdivide() {
+    if (pool == nullptr) {
+        ownPool.reset(new NodePool());
+        pool = ownPool.get();
+    }
+    QuadTree *group = pool->acquire();
     double width = bounds.width  * 0.5f;
     double height = bounds.height * 0.5f;
     double x = 0, y = 0;
@@ -158,9 +296,14 @@ void QuadTree::subdivide() {
             case 2: x = bounds.x;         y = bounds.y + height; break; // Bottom left
             case 3: x = bounds.x + width; y = bounds.y + height; break; // Bottom right
         }
-        children[i] = new QuadTree({ x, y, width, height }, capacity, maxLevel);
-        children[i]->level  = level + 1;
-        children[i]->parent = this;
+        children[i] = group + i;
+        children[i]->bounds   = { x, y, width, height };
+        children[i]->capacity = capacity;
+        children[i]->maxLevel = maxLevel;
+        children[i]->margin   = margin;
+        children[i]->level    = level + 1;
+        children[i]->parent   = this;
+        children[i]->pool     = pool;
     }
     isLeaf = false;
 }
@@ -177,8 +320,29 @@ void QuadTree::discardEmptyBuckets() {
         parent->discardEmptyBuckets();
 }
 
+// Appends pairs of the provided object with every intersecting object in this branch
+void QuadTree::getIntersections(Collidable *obj, std::vector<std::pair<Collidable*, Collidable*>> &pairs) const {
+    if (!bounds.intersects(obj->bound)) return;
+    for (Collidable *other : objects) {
+        if (other->bound.intersects(obj->bound))
+            pairs.emplace_back(obj, other);
+    }
+    if (!isLeaf) {
+        for (QuadTree *child : children)
+            child->getIntersections(obj, pairs);
+    }
+}
+
+// Sets the object's fat bound: its bound enlarged by the margin on every side
+void QuadTree::fatten(Collidable *obj) const noexcept {
+    obj->fatBound = { obj->bound.x - margin, obj->bound.y - margin,
+                      obj->bound.width + 2 * margin, obj->bound.height + 2 * margin };
+}
+
 // Returns child that contains the provided boundary
 QuadTree *QuadTree::getChild(const Rect &bound) const noexcept {
+    if (!bounds.contains(bound)) return nullptr; // Sticks out of this quadtree
+
     bool left  = bound.x + bound.width < bounds.getRight();
     bool right = bound.x > bounds.getRight();
 
@@ -192,10 +356,7 @@ QuadTree *QuadTree::getChild(const Rect &bound) const noexcept {
     return nullptr; // Cannot contain boundary -- too large
 }
 
+// Returns the children to the pool, which the root then frees with its blocks
 QuadTree::~QuadTree() {
     clear();
-    if (children[0]) delete children[0];
-    if (children[1]) delete children[1];
-    if (children[2]) delete children[2];
-    if (children[3]) delete children[3];
 }
@@ -0,0 +1,84 @@
+// Contains member functions of the SnapshotBuffer class.
+// Lock-free hand-over of Snapshots from the simulation thread to readers.
+#include "../include/SnapshotBuffer.hpp"
+
+
+// SnapshotBuffer constructor - UNSIGNED READERS (Threads that may hold a Snapshot at once)
+SnapshotBuffer::SnapshotBuffer(unsigned readers) {
+	setReaders(readers);
+}
+
+
+// Sets the number of readers that may hold a Snapshot at once, dropping every Snapshot. Only call it
+// while no reader holds one.
+void SnapshotBuffer::setReaders(unsigned readers) {
+	slots.assign(readers + 2, Snapshot());
+	holds = std::vector<std::atomic<uint32_t>>(readers + 2);
+	latest = None;
+	writing = None;
+}
+
+
+// Holds the latest Snapshot until the Lease is released. Never waits: should the writer publish another
+// between finding the latest slot and holding it, the new latest is taken instead. Any thread may call it.
+SnapshotBuffer::Lease SnapshotBuffer::acquire() const {
+	size_t slot = latest.load();
+	while (slot != None) {
+		holds[slot].fetch_add(1);
+		// The writer only fills slots that are not the latest, so a slot still the latest once held is whole.
+		size_t now = latest.load();
+		if (now == slot) {
+			return Lease(this, slot);
+		}
+		holds[slot].fetch_sub(1);
+		slot = now;
+	}
+	return Lease();
+}
+
+
+// Returns a Snapshot to fill for the next publish, or nullptr if every slot is held or the latest,
+// in which case the Snapshot is dropped. Only the writer calls it.
+Snapshot * SnapshotBuffer::write() {
+	const size_t current = latest.load();
+	for (size_t slot = 0; slot < slots.size(); slot++) {
+		if (slot != current && holds[slot].load() == 0) {
+			writing = slot;
+			return &slots[slot];
+		}
+	}
+	writing = None;
+	dropped++;
+	return nullptr;
+}
+
+
+// Makes the Snapshot filled since write the latest. Readers holding older ones keep them.
+void SnapshotBuffer::publish() {
+	if (writing == None) {
+		return;
+	}
+	latest.store(writing);
+	writing = None;
+	published++;
+}
+
+
+SnapshotBuffer::Lease & SnapshotBuffer::Lease::operator=(Lease &&other) noexcept {
+	if (this != &other) {
+		release();
+		buffer = other.buffer;
+		slot = other.slot;
+		other.buffer = nullptr;
+	}
+	return *this;
+}
+
+
+// Lets the writer reuse the Snapshot. The Lease is empty afterwards.
+void SnapshotBuffer::Lease::release() {
+	if (buffer) {
+		buffer->holds[slot].fetch_sub(1);
+		buffer = nullptr;
+	}
+}
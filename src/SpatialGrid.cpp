@@ -0,0 +1,131 @@
+#include "../include/SpatialGrid.hpp"
+
+// Keeps the cell count bounded when objects are tiny compared to the area
+static const unsigned MaxCells = 1u << 22;
+
+SpatialGrid::SpatialGrid(const Rect &_bound, double _cellSize) :
+    bounds(_bound),
+    cellSize(_cellSize) {
+    resize();
+}
+
+// Bins objects by the cell of their centre using a counting sort
+void SpatialGrid::rebuild(const std::vector<Collidable*> &objs) {
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    objectCells.resize(objs.size());
+    for (size_t i = 0; i < objs.size(); ++i) {
+        const Rect &b = objs[i]->bound;
+        unsigned cell = getRow(b.y + b.height * 0.5) * columns + getColumn(b.x + b.width * 0.5);
+        objectCells[i] = cell;
+        ++cellStart[cell + 1];
+    }
+    for (size_t cell = 1; cell < cellStart.size(); ++cell)
+        cellStart[cell] += cellStart[cell - 1];
+
+    // Scatter into place, using the run offsets as write cursors and restoring them after
+    cellObjects.resize(objs.size());
+    for (size_t i = 0; i < objs.size(); ++i)
+        cellObjects[cellStart[objectCells[i]]++] = objs[i];
+    for (size_t cell = cellStart.size() - 1; cell > 0; --cell)
+        cellStart[cell] = cellStart[cell - 1];
+    cellStart[0] = 0;
+}
+
+// Searches the cells around the provided boundary for objects within it and appends them to the caller's vector
+void SpatialGrid::getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const {
+    // Centres of intersecting objects lie at most half a cell outside the boundary
+    double reach = cellSize * 0.5;
+    unsigned left   = getColumn(bound.x - reach);
+    unsigned right  = getColumn(bound.x + bound.width + reach);
+    unsigned top    = getRow(bound.y - reach);
+    unsigned bottom = getRow(bound.y + bound.height + reach);
+    for (unsigned row = top; row <= bottom; ++row) {
+        for (unsigned column = left; column <= right; ++column) {
+            unsigned cell = row * columns + column;
+            for (unsigned i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+                Collidable *obj = cellObjects[i];
+                // Only check for intersection with OTHER boundaries
+                if (&obj->bound != &bound && obj->bound.intersects(bound))
+                    found.push_back(obj);
+            }
+        }
+    }
+}
+
+// Appends every pair of objects whose boundaries intersect, each pair exactly once
+void SpatialGrid::getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs) const {
+    for (unsigned row = 0; row < rows; ++row) {
+        for (unsigned column = 0; column < columns; ++column) {
+            unsigned cell = row * columns + column;
+            if (cellStart[cell] == cellStart[cell + 1]) continue;
+
+            // Pairs within the cell
+            for (unsigned i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+                for (unsigned j = i + 1; j < cellStart[cell + 1]; ++j) {
+                    if (cellObjects[i]->bound.intersects(cellObjects[j]->bound))
+                        pairs.emplace_back(cellObjects[i], cellObjects[j]);
+                }
+            }
+            // Pairs with the forward half of the neighbours: right, and the three cells below
+            if (column + 1 < columns) pairCells(cell, cell + 1, pairs);
+            if (row + 1 < rows) {
+                if (column > 0) pairCells(cell, cell + columns - 1, pairs);
+                pairCells(cell, cell + columns, pairs);
+                if (column + 1 < columns) pairCells(cell, cell + columns + 1, pairs);
+            }
+        }
+    }
+}
+
+// Sets the cell size, which must be at least the width and height of the largest object
+void SpatialGrid::setCellSize(double size) noexcept {
+    if (size == cellSize) return;
+    cellSize = size;
+    resize();
+}
+
+double SpatialGrid::getCellSize() const noexcept {
+    return cellSize;
+}
+
+// Returns total cell count for this grid
+unsigned SpatialGrid::totalCells() const noexcept {
+    return columns * rows;
+}
+
+// Recomputes the grid dimensions for the current cell size
+void SpatialGrid::resize() {
+    if (cellSize <= 0) cellSize = 1;
+    while ((bounds.width / cellSize + 1) * (bounds.height / cellSize + 1) > MaxCells)
+        cellSize *= 2;
+    columns = (unsigned)(bounds.width / cellSize) + 1;
+    rows    = (unsigned)(bounds.height / cellSize) + 1;
+    cellStart.assign((size_t)columns * rows + 1, 0);
+    cellObjects.clear();
+}
+
+// Returns the column holding x, clamping positions outside the grid to its edges
+unsigned SpatialGrid::getColumn(double x) const noexcept {
+    double column = (x - bounds.x) / cellSize;
+    if (column < 0) return 0;
+    if (column >= columns) return columns - 1;
+    return (unsigned)column;
+}
+
+// Returns the row holding y, clamping positions outside the grid to its edges
+unsigned SpatialGrid::getRow(double y) const noexcept {
+    double row = (y - bounds.y) / cellSize;
+    if (row < 0) return 0;
+    if (row >= rows) return rows - 1;
+    return (unsigned)row;
+}
+
+// Appends the intersecting pairs between two different cells
+void SpatialGrid::pairCells(unsigned a, unsigned b, std::vector<std::pair<Collidable*, Collidable*>> &pairs) const {
+    for (unsigned i = cellStart[a]; i < cellStart[a + 1]; ++i) {
+        for (unsigned j = cellStart[b]; j < cellStart[b + 1]; ++j) {
+            if (cellObjects[i]->bound.intersects(cellObjects[j]->bound))
+                pairs.emplace_back(cellObjects[i], cellObjects[j]);
+        }
+    }
+}
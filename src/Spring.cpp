@@ -13,9 +13,15 @@ p1(p1), p2(p2), length(restlength), strength(strength) {
 void Spring::update() {
 	float dx = p1->getX() - p2->getX();
 	float dy = p1->getY() - p2->getY();
-	float distance = hypot(dx, dy) - length;
-	float theta = atan2(dy, dx);
+	float separation = sqrt(dx * dx + dy * dy);
+	float distance = separation - length;
 	float force = (length - distance) * strength;
-	p1->accelerate(Vector{static_cast<float>(theta + 0.5*M_PI), force / p1->getMass()});
-	p2->accelerate(Vector{static_cast<float>(theta - 0.5*M_PI), force / p2->getMass()});
+	// Unit vector pointing from p2 towards p1.
+	float nx = 1, ny = 0;
+	if (separation > 0) {
+		nx = dx / separation;
+		ny = dy / separation;
+	}
+	p1->accelerate(nx * force / p1->getMass(), ny * force / p1->getMass());
+	p2->accelerate(-nx * force / p2->getMass(), -ny * force / p2->getMass());
 }
@@ -0,0 +1,43 @@
+// Contains member functions of the SpringStore struct.
+// Structure-of-arrays storage for the springs of an Environment.
+#include "../include/SpringStore.hpp"
+#include "../include/Spring.hpp"
+
+
+// Appends a slot for the handle and returns its index.
+size_t SpringStore::add(Spring *handle, uint32_t p1, uint32_t p2, float length, float strength) {
+	ends.push_back({p1, p2});
+	this->length.push_back(length);
+	this->strength.push_back(strength);
+	lambda.push_back(0);
+	handles.push_back(handle);
+	handle->index = handles.size() - 1;
+	return handle->index;
+}
+
+
+// Removes a slot by moving the last slot into its place and updating that slot's handle.
+void SpringStore::remove(size_t index) {
+	const size_t last = handles.size() - 1;
+	ends[index] = ends[last];
+	length[index] = length[last];
+	strength[index] = strength[last];
+	lambda[index] = lambda[last];
+	handles[index] = handles[last];
+	handles[index]->index = index;
+	ends.pop_back();
+	length.pop_back();
+	strength.pop_back();
+	lambda.pop_back();
+	handles.pop_back();
+}
+
+
+// Reserves room for n springs in every array.
+void SpringStore::reserve(size_t n) {
+	ends.reserve(n);
+	length.reserve(n);
+	strength.reserve(n);
+	lambda.reserve(n);
+	handles.reserve(n);
+}
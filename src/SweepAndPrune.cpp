@@ -0,0 +1,98 @@
+#include "../include/SweepAndPrune.hpp"
+
+// Inserts an object at its place in the sorted order
+bool SweepAndPrune::insert(Collidable *obj) {
+    Entry entry = { obj->bound.x, obj->bound.x + obj->bound.width, obj };
+    auto at = std::upper_bound(entries.begin(), entries.end(), entry.min,
+        [](double min, const Entry &other) { return min < other.min; });
+    for (auto it = entries.insert(at, entry); it != entries.end(); ++it) {
+        if (it->obj) it->obj->sweepIndex = (uint32_t)(it - entries.begin());
+    }
+    return true;
+}
+
+// Removes an object by emptying its entry, leaving the sorted order as it is
+bool SweepAndPrune::remove(Collidable *obj) {
+    size_t at = obj->sweepIndex;
+    if (at >= entries.size() || entries[at].obj != obj) return false;
+    entries[at].obj = nullptr;
+    // Without updates to close them, gaps could pile up; past half the entries they are closed here
+    if (++removed * 2 > entries.size()) compact();
+    return true;
+}
+
+// Closes the gaps left by removed objects, keeping the order
+void SweepAndPrune::compact() {
+    size_t kept = 0;
+    for (const Entry &entry : entries) {
+        if (!entry.obj) continue;
+        entry.obj->sweepIndex = (uint32_t)kept;
+        entries[kept++] = entry;
+    }
+    entries.resize(kept);
+    removed = 0;
+}
+
+// Refreshes the endpoints from the objects' bounds and restores the order (for objects that move),
+// closing the gaps left by removed objects on the way
+void SweepAndPrune::update() {
+    size_t kept = 0;
+    for (const Entry &entry : entries) {
+        if (!entry.obj) continue;
+        Collidable *obj = entry.obj;
+        obj->sweepIndex = (uint32_t)kept;
+        entries[kept++] = { obj->bound.x, obj->bound.x + obj->bound.width, obj };
+    }
+    entries.resize(kept);
+    removed = 0;
+    // Insertion sort: each object only travels past the neighbours it overtook since the last update
+    for (size_t i = 1; i < entries.size(); ++i) {
+        Entry entry = entries[i];
+        size_t j = i;
+        while (j > 0 && entries[j - 1].min > entry.min) {
+            entries[j] = entries[j - 1];
+            entries[j].obj->sweepIndex = (uint32_t)j;
+            --j;
+        }
+        if (j != i) {
+            entries[j] = entry;
+            entry.obj->sweepIndex = (uint32_t)j;
+        }
+    }
+}
+
+// Searches for objects within the provided boundary and appends them to the caller's vector
+void SweepAndPrune::getObjectsInBound(const Rect &bound, std::vector<Collidable*> &found) const {
+    double right = bound.x + bound.width;
+    for (const Entry &entry : entries) {
+        if (entry.min > right) break; // Everything further along starts past the boundary
+        if (!entry.obj) continue;
+        // Only check for intersection with OTHER boundaries
+        if (entry.max >= bound.x && &entry.obj->bound != &bound && entry.obj->bound.intersects(bound))
+            found.push_back(entry.obj);
+    }
+}
+
+// Appends every pair of objects whose boundaries intersect, each pair exactly once
+void SweepAndPrune::getIntersectingPairs(std::vector<std::pair<Collidable*, Collidable*>> &pairs) const {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry &entry = entries[i];
+        if (!entry.obj) continue;
+        // Only objects starting before this one ends can overlap it on the sweep axis
+        for (size_t j = i + 1; j < entries.size() && entries[j].min <= entry.max; ++j) {
+            if (entries[j].obj && entry.obj->bound.intersects(entries[j].obj->bound))
+                pairs.emplace_back(entry.obj, entries[j].obj);
+        }
+    }
+}
+
+// Returns total object count
+unsigned SweepAndPrune::totalObjects() const noexcept {
+    return (unsigned)(entries.size() - removed);
+}
+
+// Removes all objects
+void SweepAndPrune::clear() noexcept {
+    entries.clear();
+    removed = 0;
+}
@@ -0,0 +1,102 @@
+// Contains member functions of the ThreadPool class.
+// Runs loops over a range of items on a fixed set of worker threads.
+#include "../include/ThreadPool.hpp"
+#include <algorithm>
+
+
+// ThreadPool constructor. One worker runs everything on the calling thread.
+ThreadPool::ThreadPool(unsigned workers) {
+	start(workers);
+}
+
+
+// ThreadPool destructor. Joins the worker threads.
+ThreadPool::~ThreadPool() {
+	stop();
+}
+
+
+// Calls task(begin, end) on contiguous chunks covering [0, count) and returns once all have finished.
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &task) {
+	unsigned chunks = std::min<size_t>(workerCount, count / MinChunk);
+	if (chunks <= 1) {
+		task(0, count);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		taskCount = count;
+		taskChunks = chunks;
+		pending = chunks - 1;
+		generation++;
+	}
+	wake.notify_all();
+	task(0, count / chunks);
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return pending == 0; });
+	this->task = nullptr;
+}
+
+
+// Replaces the worker threads with the requested number of workers, counting the calling thread.
+void ThreadPool::setWorkerCount(unsigned workers) {
+	if (workers == 0) {
+		workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (workers == workerCount) {
+		return;
+	}
+	stop();
+	start(workers);
+}
+
+
+// Starts the worker threads.
+void ThreadPool::start(unsigned workers) {
+	workerCount = std::max(1u, workers);
+	stopping = false;
+	for (unsigned i = 1; i < workerCount; i++) {
+		threads.emplace_back(&ThreadPool::work, this, i, generation);
+	}
+}
+
+
+// Stops and joins the worker threads.
+void ThreadPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+
+// Worker loop: waits for a task newer than generation seen and runs its chunk.
+// seen is taken when the thread is started, so a task posted before the thread first runs is not missed.
+void ThreadPool::work(unsigned worker, unsigned seen) {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [&] { return stopping || generation != seen; });
+		if (stopping) {
+			return;
+		}
+		seen = generation;
+		if (worker >= taskChunks) {
+			continue;
+		}
+		const std::function<void(size_t, size_t)> &run = *task;
+		size_t begin = taskCount * worker / taskChunks;
+		size_t end = taskCount * (worker + 1) / taskChunks;
+		lock.unlock();
+		run(begin, end);
+		lock.lock();
+		if (--pending == 0) {
+			done.notify_one();
+		}
+	}
+}
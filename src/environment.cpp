@@ -1,26 +1,32 @@
 // Contains member functions of the Environment class.
 // Handles all interaction between Joints, springs and attributes within the environment.
 #include "../include/environment.hpp"
+#include <cstdio>
 
 
-// Environment constructor - INT WIDTH, INT HEIGHT, VECTOR GRAVITY (Angle (Radians) - Speed)
-Environment::Environment(int width, int height, Vector GravVector):
-width(width), height(height), acceleration(GravVector){
-	quadTree = new QuadTree({ 0, 0, (double)width, (double)height}, 8, 4);
+// Environment constructor - INT WIDTH, INT HEIGHT, VECTOR GRAVITY (Angle (Radians) - Speed), BROADPHASE (Structure finding touching Joints)
+Environment::Environment(int width, int height, Vector GravVector, BroadPhase broadPhase):
+width(width), height(height), broadPhase(broadPhase), acceleration(GravVector){
+	if (broadPhase == BroadPhase::Grid) {
+		grid = new SpatialGrid({ 0, 0, (double)width, (double)height}, 40);
+	} else if (broadPhase == BroadPhase::SweepAndPrune) {
+		sweepAndPrune = new SweepAndPrune();
+	} else if (broadPhase == BroadPhase::LinearQuadTree) {
+		linearTree = new LinearQuadTree({ 0, 0, (double)width, (double)height}, 8);
+	} else {
+		quadTree = new QuadTree({ 0, 0, (double)width, (double)height}, 8, 8);
+		quadTree->setMargin(treeMargin);
+	}
 }
 
 
-// Environment destructor. Destroys all Joints and springs in the environment.
+// Environment destructor. The pools destroy the remaining Joints, springs, Lines and Collidables.
 Environment::~Environment() {
-	for (int i = 0; i < Springs.size(); i++) {
-		delete Springs[i];
-	}
-	for (int i = 0; i < Joints.size(); i++) {
-		delete Joints[i];
-	}
-	for (int i = 0; i < Lines.size(); i++) {
-		delete Lines[i];
-	}
+	// The QuadTree still refers to the Collidables while it is cleared.
+	delete quadTree;
+	delete grid;
+	delete sweepAndPrune;
+	delete linearTree;
 }
 
 
@@ -50,33 +56,105 @@ Joint * Environment::addJoint() {
 Joint * Environment::addJoint(float x, float y, float size, float mass, float speed, float angle, float elasticity) {
 	// Equation for drag [source]: http://www.petercollingridge.co.uk/tutorials/pygame-physics-simulation/mass/
 	float drag = pow((mass / (mass + airMass)), size);
-	Joint *joint = new Joint(x, y, size, mass, speed, angle, elasticity, drag);
-	Collidable *obj = new Collidable({{x-(size*2), y-(size*2), size*4, size*4}, size});
-	quadTree->insert(obj);
+	Joint *joint = JointPool.create(&Joints, Joints.count());
+	size_t index = Joints.add(joint, x, y, size, mass, speed, angle, elasticity, drag);
+	Collidable *obj = CollidablePool.create(Rect(x - size, y - size, size * 2, size * 2), CollidableId{JointCollidable, (uint32_t)index});
+	if (quadTree) {
+		quadTree->insert(obj);
+	}
+	if (sweepAndPrune) {
+		sweepAndPrune->insert(obj);
+	}
 	Collidables.push_back(obj);
-	Joints.push_back(joint);
+	// New Joints start awake, so the Joint moves in front of the sleeping ones.
+	swapJoints(index, awakeCount);
+	awakeCount++;
 	return joint;
 }
 
 // Returns a pointer to the Joint from the environment at the coordinates (x, y), otherwise nullptr.
 Joint * Environment::getJoint(float x, float y){
-	for (int i = 0; i < Joints.size(); i++) {
-		if (hypot(Joints[i]->getX() - x, Joints[i]->getY() - y) <= Joints[i]->getSize()) {
-			return Joints[i];
+	for (size_t i = 0; i < Joints.count(); i++) {
+		if (hypot(Joints.x[i] - x, Joints.y[i] - y) <= Joints.size[i]) {
+			return Joints.handles[i];
 		}
 	}
 	return nullptr;
 }
 
 
+// Packs the position and size of every Joint, in the order of getJoints, into one buffer a renderer can
+// upload as it is. The buffer is repacked on each call, in one pass over the Joints' arrays, and is
+// overwritten by the next call.
+Span<const JointVertex> Environment::getJointVertices() {
+	const size_t count = Joints.count();
+	JointVertices.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		JointVertices[i] = {Joints.x[i], Joints.y[i], Joints.size[i]};
+	}
+	return JointVertices;
+}
+
+
 Line * Environment::addLine(float StartX, float StartY, float EndX, float EndY, float LineWidth){
-	Line *line = new Line(StartX, StartY, EndX, EndY, LineWidth);
+	Line *line = LinePool.create(StartX, StartY, EndX, EndY, LineWidth);
+	line->index = Lines.size();
 	Lines.push_back(line);
+	linesMoved = true;
+	// Sweep and prune keeps Lines and Joints in the same structure.
+	if (sweepAndPrune) {
+		Collidable *obj = CollidablePool.create(getLineBound(line), CollidableId{LineCollidable, (uint32_t)line->index});
+		sweepAndPrune->insert(obj);
+		LineCollidables.push_back(obj);
+	}
 	return line;
 }
 
+// Switches attraction between exact pairwise forces and the Barnes-Hut approximation.
+void Environment::setAllowBarnesHut(bool setting) {
+	allowBarnesHut = setting;
+	// Barnes-Hut needs the QuadTree even when another broad phase finds touching Joints.
+	if (setting && !quadTree) {
+		quadTree = new QuadTree({ 0, 0, (double)width, (double)height}, 8, 8);
+		quadTree->setMargin(treeMargin);
+		for (size_t i = 0; i < Collidables.size(); i++) {
+			quadTree->insert(Collidables[i]);
+		}
+	}
+}
+
+
+// Lets Joints that stay at rest stop being updated until something disturbs them.
+void Environment::setAllowSleep(bool setting) {
+	allowSleep = setting;
+	if (!setting) {
+		wakeAll();
+	}
+}
+
+
+// Sets how far a Joint may move before the QuadTree places it again. Larger margins mean fewer
+// reinsertions of slowly drifting Joints but more Joints held in large nodes, which costs pair tests.
+// Joints at rest are never reinserted, whatever the margin.
+void Environment::setTreeMargin(float margin) {
+	treeMargin = margin;
+	if (quadTree) {
+		quadTree->setMargin(margin);
+	}
+}
+
+
+// Returns the bounding rectangle of a Line, including its width.
+Rect Environment::getLineBound(Line *line) {
+	float left = std::min(line->getStartX(), line->getEndX()) - line->getWidth();
+	float top = std::min(line->getStartY(), line->getEndY()) - line->getWidth();
+	float right = std::max(line->getStartX(), line->getEndX()) + line->getWidth();
+	float bottom = std::max(line->getStartY(), line->getEndY()) + line->getWidth();
+	return Rect(left, top, right - left, bottom - top);
+}
+
 Line * Environment::getLine(float x, float y){
-	for (int i = 0; i < Lines.size(); i++) {
+	for (size_t i = 0; i < Lines.size(); i++) {
 		if (hypot(Lines[i]->getStartX() - x, Lines[i]->getStartY() - y) <= Lines[i]->getWidth() || hypot(Lines[i]->getEndX() - x, Lines[i]->getEndY() - y) <= Lines[i]->getWidth() ) {
 			return Lines[i];
 		}
@@ -87,115 +165,1323 @@ Line * Environment::getLine(float x, float y){
 
 // Adds a spring connecting two Joints in the environment and returns a pointer to the spring.
 Spring * Environment::addSpring(Joint *p1, Joint *p2, float length, float strength) {
-	Spring *spring = new Spring(p1, p2, length, strength);
-	Springs.push_back(spring);
+	wake(p1);
+	wake(p2);
+	Spring *spring = SpringPool.create(p1, p2, length, strength);
+	Springs.add(spring, p1->index, p2->index, length, strength);
+	springsChanged = true;
+	p1->springs.push_back(spring);
+	p2->springs.push_back(spring);
 	return spring;
 }
 
 
 // Bounces a Joint if in contact with boundary of the environment.
 void Environment::bounce(Joint *Joint) {
+	float vx = Joint->getVelocityX();
+	float vy = Joint->getVelocityY();
+	float elasticity = Joint->getElasticity();
 	// Joint hits the right boundary:
 	if (Joint->getX() > (width - Joint->getSize())) {
 		Joint->setX(2 * (width - Joint->getSize()) - Joint->getX());
-		Joint->setAngle(-Joint->getAngle());
-		Joint->setSpeed(Joint->getSpeed() * Joint->getElasticity());
+		vx = -vx * elasticity;
+		vy *= elasticity;
 	// Joint hits the left boundary:
 	} else if (Joint->getX() < Joint->getSize()) {
 		Joint->setX(2 * Joint->getSize() - Joint->getX());
-		Joint->setAngle(-Joint->getAngle());
-		Joint->setSpeed(Joint->getSpeed() * Joint->getElasticity());
+		vx = -vx * elasticity;
+		vy *= elasticity;
 	}
 	// Joint hits the bottom boundary:
 	if (Joint->getY() > (height - Joint->getSize())) {
 		Joint->setY(2 * (height - Joint->getSize()) - Joint->getY());
-		Joint->setAngle(M_PI - Joint->getAngle());
-		Joint->setSpeed(Joint->getSpeed() * Joint->getElasticity());
+		vx *= elasticity;
+		vy = -vy * elasticity;
 	// Joint hits the top boundary:
 	} else if (Joint->getY() < Joint->getSize()) {
 		Joint->setY(2 * Joint->getSize() - Joint->getY());
-		Joint->setAngle(M_PI - Joint->getAngle());
-		Joint->setSpeed(Joint->getSpeed() * Joint->getElasticity());
+		vx *= elasticity;
+		vy = -vy * elasticity;
 	}
+	Joint->setVelocity(vx, vy);
 }
 
 
-// Removes a Joint from the environment.
+// Removes a Joint from the environment, along with its springs and its entry in the broad phase.
+// The last Joint takes its slot, so other Joints' indices may change.
 void Environment::removeJoint(Joint *Joint) {
-	for (int i = 0; i < Joints.size(); i++) {
-		if (Joint == Joints[i]) {
-			delete Joints[i];
-			Joints.erase(Joints.begin() + i);
-		}
+	if (Joint->getStore() != &Joints) {
+		return;
+	}
+	// The rest of its island may have been leaning on the Joint.
+	wake(Joint);
+	while (!Joint->springs.empty()) {
+		removeSpring(Joint->springs.back());
+	}
+	// The last awake Joint fills the gap first, so the awake Joints stay in front.
+	size_t i = Joint->getIndex();
+	awakeCount--;
+	swapJoints(i, awakeCount);
+	i = awakeCount;
+	Collidable *obj = Collidables[i];
+	if (quadTree) {
+		quadTree->remove(obj);
+	}
+	if (sweepAndPrune) {
+		sweepAndPrune->remove(obj);
+	}
+	Collidables[i] = Collidables.back();
+	Collidables[i]->data.index = i;
+	Collidables.pop_back();
+	Joints.remove(i);
+	if (i < Joints.count()) {
+		refreshSpringEnds(Joints.handles[i]);
+	}
+	CollidablePool.destroy(obj);
+	JointPool.destroy(Joint);
+}
+
+
+// Removes the Joint a handle refers to, if it is still in the environment.
+void Environment::removeJoint(JointHandle handle) {
+	if (Joint *joint = JointPool.get(handle)) {
+		removeJoint(joint);
+	}
+}
+
+
+// Removes a Line from the environment. The last Line takes its place.
+void Environment::removeLine(Line *line) {
+	size_t i = line->index;
+	if (i >= Lines.size() || Lines[i] != line) {
+		return;
+	}
+	Lines[i] = Lines.back();
+	Lines[i]->index = i;
+	Lines.pop_back();
+	if (sweepAndPrune) {
+		Collidable *obj = LineCollidables[i];
+		sweepAndPrune->remove(obj);
+		LineCollidables[i] = LineCollidables.back();
+		LineCollidables[i]->data.index = i;
+		LineCollidables.pop_back();
+		CollidablePool.destroy(obj);
+	}
+	linesMoved = true;
+	LinePool.destroy(line);
+}
+
+
+// Removes the Line a handle refers to, if it is still in the environment.
+void Environment::removeLine(LineHandle handle) {
+	if (Line *line = LinePool.get(handle)) {
+		removeLine(line);
 	}
 }
 
 
-// Removes a spring from the environment.
+// Removes a spring from the environment and from the Joints it connects. The last spring takes its place.
 void Environment::removeSpring(Spring *spring) {
-	for (int i = 0; i < Springs.size(); i++) {
-		if (spring == Springs[i]) {
-			delete Springs[i];
-			Springs.erase(Springs.begin() + i);
+	size_t i = spring->index;
+	if (i >= Springs.count() || Springs.handles[i] != spring) {
+		return;
+	}
+	wake(spring->getP1());
+	wake(spring->getP2());
+	for (Joint *joint : {spring->getP1(), spring->getP2()}) {
+		std::vector<Spring *> &attached = joint->springs;
+		auto at = std::find(attached.begin(), attached.end(), spring);
+		if (at != attached.end()) {
+			*at = attached.back();
+			attached.pop_back();
 		}
 	}
+	Springs.remove(i);
+	springsChanged = true;
+	SpringPool.destroy(spring);
 }
 
 
-// Updates all Joints and springs in the environment.
-void Environment::update() {
-	for (int i = 0; i < Collidables.size(); i++){
-		Collidable *c = Collidables[i];
-		c->bound.x = Joints.at(i)->getX();
-		c->bound.y = Joints.at(i)->getY();
-		quadTree->update(c);
+// Removes the spring a handle refers to, if it is still in the environment.
+void Environment::removeSpring(SpringHandle handle) {
+	if (Spring *spring = SpringPool.get(handle)) {
+		removeSpring(spring);
 	}
-	for (int i = 0; i < Joints.size(); i++) {
-		Joint *j = Joints[i];
-		if (allowAccelerate) {
-			j->accelerate(acceleration);
+}
+
+
+// Spreads the bits of a 16-bit cell coordinate apart, so two coordinates interleave into a Morton code.
+static uint32_t spreadBits(uint32_t v) {
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+
+// Sorts the Joints by the Morton code of their position, so Joints close in space are close in memory
+// and the pair and spring passes touch fewer cache lines. Awake and sleeping Joints are sorted separately.
+// Joint pointers and handles, springs and the broad phases all stay valid; only getIndex changes.
+void Environment::reorder() {
+	const size_t count = Joints.count();
+	const float columnScale = 65535.0f / width;
+	const float rowScale = 65535.0f / height;
+	ReorderKeys.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		uint32_t column = std::min(std::max(Joints.x[i] * columnScale, 0.0f), 65535.0f);
+		uint32_t row = std::min(std::max(Joints.y[i] * rowScale, 0.0f), 65535.0f);
+		// The index in the low bits keeps the order of Joints in the same cell.
+		ReorderKeys[i] = (uint64_t)(spreadBits(column) | spreadBits(row) << 1) << 32 | i;
+	}
+	std::sort(ReorderKeys.begin(), ReorderKeys.begin() + awakeCount);
+	std::sort(ReorderKeys.begin() + awakeCount, ReorderKeys.end());
+	ReorderOrder.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		ReorderOrder[i] = (uint32_t)ReorderKeys[i];
+	}
+	Joints.permute(ReorderOrder);
+	for (size_t i = 0; i < Springs.count(); i++) {
+		Springs.ends[i] = {(uint32_t)Springs.handles[i]->p1->index, (uint32_t)Springs.handles[i]->p2->index};
+	}
+	ReorderCollidables.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		ReorderCollidables[i] = Collidables[ReorderOrder[i]];
+		ReorderCollidables[i]->data.index = i;
+	}
+	Collidables.swap(ReorderCollidables);
+	// Without a QuadTree or sweep and prune nothing holds on to Collidables between updates, so they are
+	// made again in the order of their Joints. Destroyed from the highest pool slot down, their slots
+	// come back off the pool's freelist from the lowest up.
+	if (!quadTree && !sweepAndPrune) {
+		ReorderContents.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			ReorderContents[i] = {Collidables[i]->bound, Collidables[i]->mass};
+		}
+		ReorderCollidables = Collidables;
+		std::sort(ReorderCollidables.begin(), ReorderCollidables.end(), [this](Collidable *a, Collidable *b) {
+			return CollidablePool.getHandle(a).index > CollidablePool.getHandle(b).index;
+		});
+		for (Collidable *obj : ReorderCollidables) {
+			CollidablePool.destroy(obj);
 		}
+		for (size_t i = 0; i < count; i++) {
+			Collidables[i] = CollidablePool.create(ReorderContents[i].first, CollidableId{JointCollidable, (uint32_t)i});
+			Collidables[i]->mass = ReorderContents[i].second;
+		}
+	}
+	updatesSinceReorder = 0;
+}
+
+
+// Exchanges the slots of two Joints along with their Collidables.
+void Environment::swapJoints(size_t a, size_t b) {
+	if (a == b) {
+		return;
+	}
+	Joints.swap(a, b);
+	std::swap(Collidables[a], Collidables[b]);
+	Collidables[a]->data.index = a;
+	Collidables[b]->data.index = b;
+	refreshSpringEnds(Joints.handles[a]);
+	refreshSpringEnds(Joints.handles[b]);
+}
+
+
+// Updates the SpringStore ends of a Joint's springs after the Joint changed slots.
+void Environment::refreshSpringEnds(Joint *joint) {
+	for (Spring *spring : joint->springs) {
+		Springs.ends[spring->index] = {(uint32_t)spring->p1->index, (uint32_t)spring->p2->index};
+	}
+}
+
+
+// Wakes the island a Joint sleeps in, if it is asleep.
+void Environment::wake(Joint *joint) {
+	if (joint->isAsleep()) {
+		wakeIsland(Joints.island[joint->index]);
+	}
+}
+
+
+// Drops the acceleration a Joint kept from before it slept, which velocity Verlet and multi-rate stepping
+// would otherwise kick it with, and puts it back on the shortest multi-rate step.
+void Environment::clearAcceleration(size_t i) {
+	Joints.ax[i] = 0;
+	Joints.ay[i] = 0;
+	Joints.level[i] = 0;
+}
+
+
+// Wakes every Joint of a sleeping island, moving them back among the awake Joints.
+void Environment::wakeIsland(uint32_t island) {
+	if (island >= Islands.size() || Islands[island].empty()) {
+		return;
+	}
+	for (Joint *joint : Islands[island]) {
+		size_t i = joint->index;
+		Joints.island[i] = JointStore::Awake;
+		Joints.restFrames[i] = 0;
+		clearAcceleration(i);
+		swapJoints(i, awakeCount);
+		awakeCount++;
+	}
+	Islands[island].clear();
+	FreeIslands.push_back(island);
+}
+
+
+// Wakes every Joint. The order of the Joints does not need to change.
+void Environment::wakeAll() {
+	for (size_t i = awakeCount; i < Joints.count(); i++) {
+		Joints.island[i] = JointStore::Awake;
+		Joints.restFrames[i] = 0;
+		clearAcceleration(i);
+	}
+	awakeCount = Joints.count();
+	Islands.clear();
+	FreeIslands.clear();
+}
+
+
+// Puts to sleep every island whose Joints have all stayed slower than sleepSpeed for sleepFrames updates.
+// An island is a group of awake Joints joined by springs or by the touching pairs of this update.
+void Environment::sleepIslands() {
+	bool ready = false;
+	for (size_t i = 0; i < awakeCount; i++) {
+		if (Joints.vx[i] * Joints.vx[i] + Joints.vy[i] * Joints.vy[i] < sleepSpeed * sleepSpeed) {
+			Joints.restFrames[i] = std::min(Joints.restFrames[i] + 1, sleepFrames);
+		} else {
+			Joints.restFrames[i] = 0;
+		}
+		ready |= Joints.restFrames[i] >= sleepFrames;
+	}
+	if (!ready) {
+		return;
+	}
+	// Union-find over the awake Joints. Pairs with a Line or a sleeping Joint do not join anything.
+	std::vector<uint32_t> &parent = IslandParent;
+	parent.resize(awakeCount);
+	for (size_t i = 0; i < awakeCount; i++) {
+		parent[i] = i;
+	}
+	auto find = [&](uint32_t i) {
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	};
+	auto join = [&](uint32_t a, uint32_t b) {
+		if (a < awakeCount && b < awakeCount) {
+			a = find(a);
+			b = find(b);
+			parent[std::max(a, b)] = std::min(a, b);
+		}
+	};
+	for (const std::pair<uint32_t, uint32_t> &pair : PairJoints) {
+		join(pair.first, pair.second);
+	}
+	for (const std::pair<uint32_t, uint32_t> &pair : Springs.ends) {
+		join(pair.first, pair.second);
+	}
+	// The least rested Joint decides for its island. Each root then holds its island's id, or Awake.
+	IslandRest.assign(awakeCount, UINT32_MAX);
+	for (size_t i = 0; i < awakeCount; i++) {
+		parent[i] = find(i);
+		IslandRest[parent[i]] = std::min(IslandRest[parent[i]], Joints.restFrames[i]);
+	}
+	std::vector<uint32_t> &asleep = IslandsAsleep;
+	asleep.clear();
+	for (size_t i = 0; i < awakeCount; i++) {
+		if (parent[i] != i) {
+			continue;
+		}
+		if (IslandRest[i] < sleepFrames) {
+			IslandRest[i] = JointStore::Awake;
+			continue;
+		}
+		if (FreeIslands.empty()) {
+			FreeIslands.push_back(Islands.size());
+			Islands.emplace_back();
+		}
+		IslandRest[i] = FreeIslands.back();
+		FreeIslands.pop_back();
+		asleep.push_back(IslandRest[i]);
+	}
+	for (size_t i = 0; i < awakeCount; i++) {
+		if (IslandRest[parent[i]] != JointStore::Awake) {
+			Islands[IslandRest[parent[i]]].push_back(Joints.handles[i]);
+		}
+	}
+	// Sleeping Joints move behind the awake ones, which keeps every per-Joint pass to the front of the arrays.
+	for (uint32_t island : asleep) {
+		for (Joint *joint : Islands[island]) {
+			size_t i = joint->index;
+			Joints.island[i] = island;
+			Joints.vx[i] = 0;
+			Joints.vy[i] = 0;
+			awakeCount--;
+			swapJoints(i, awakeCount);
+		}
+	}
+}
+
+
+// Moves Joints begin to end - 1 through the current step under gravity, drag and the boundaries.
+// Each pass is a batch kernel streaming through the Joint arrays in order.
+void Environment::integrate(size_t begin, size_t end) {
+	const Kernels &kernels = getKernels();
+	const size_t count = end - begin;
+	const float h = stepTime;
+	float *x = Joints.x.data() + begin;
+	float *y = Joints.y.data() + begin;
+	float *vx = Joints.vx.data() + begin;
+	float *vy = Joints.vy.data() + begin;
+	float gx = 0, gy = 0;
+	if (allowAccelerate) {
+		gx = sin(acceleration.angle) * acceleration.speed;
+		gy = -cos(acceleration.angle) * acceleration.speed;
+	}
+	if (allowMultiRate) {
+		// Every Joint drifts each update; forces, gravity included, arrive as kicks at the end of the update.
 		if (allowMove) {
-			j->move();
+			kernels.move(x, y, vx, vy, 0, 0, h, count);
 		}
-		if (allowDrag) {
-			j->experienceDrag();
+	} else if (integrator == Integrator::VelocityVerlet) {
+		// The first half of the last update's acceleration, gravity included; the second half follows
+		// once the forces of this update are known.
+		const float *ax = Joints.ax.data() + begin;
+		const float *ay = Joints.ay.data() + begin;
+		for (size_t i = 0; i < count; i++) {
+			vx[i] += 0.5f * h * ax[i];
+			vy[i] += 0.5f * h * ay[i];
 		}
-		if (allowBounce) {
-			bounce(j);
+		if (allowMove) {
+			kernels.move(x, y, vx, vy, 0, 0, h, count);
 		}
-		if (fabs(j->getSpeed()) < Stable){
-			j->setSpeed(0);
-			j->setAngle(0);
+	} else if (allowMove) {
+		kernels.move(x, y, vx, vy, gx * h, gy * h, h, count);
+	} else if (allowAccelerate) {
+		for (size_t i = 0; i < count; i++) {
+			vx[i] += gx * h;
+			vy[i] += gy * h;
 		}
-		// Allows interaction with other Joints.
-		for (int x = i+1; x < Joints.size(); x++) {
-			Joint *otherJoint = Joints[x];
-			if(Collidables.at(i)->bound.intersects(Collidables.at(x)->bound))
-			if (allowCollide) {
-				j->checkCollide(otherJoint);
+	}
+	if (allowDrag) {
+		// Drag is the share of velocity kept per unit of time, taken to first order in shorter or longer steps.
+		const float *drag = Joints.drag.data() + begin;
+		if (h != 1) {
+			float *stepDrag = StepDrag.data() + begin;
+			for (size_t i = 0; i < count; i++) {
+				stepDrag[i] = std::max(1 - (1 - drag[i]) * h, 0.0f);
 			}
-			if (allowAttract) {
-				j->attract(otherJoint);
+			drag = stepDrag;
+		}
+		kernels.drag(vx, vy, drag, count);
+	}
+	// The impulse solver holds Joints against the walls along with its contacts, and settles them once
+	// it has, so that a Joint resting on others keeps the pull of gravity its contacts hold it against.
+	if (allowCollide && contactSolver == ContactSolver::Impulse) {
+		return;
+	}
+	if (allowBounce) {
+		kernels.bounce(x, y, vx, vy, Joints.size.data() + begin, Joints.elasticity.data() + begin, width, height, count);
+	}
+	// The threshold shrinks with the step, so gravity acting over a short step still gets a Joint moving.
+	kernels.settle(vx, vy, Stable * h, count);
+}
+
+
+// Gives each Joint whose forces were due this update its next step: the longest power of two updates,
+// up to 2^multiRateLevels, over which its speed and acceleration move it by at most multiRateTolerance
+// of its size. A step may only be as long as the count of updates allows to end on a multiple of itself,
+// so Joints sharing a step stay in phase and only move to longer steps at common boundaries.
+// The Joint is then kicked by its acceleration for the whole step. Only the first count Joints, those
+// integrated this update, are kicked.
+void Environment::kickMultiRate(size_t count) {
+	unsigned aligned = 0;
+	while (aligned < multiRateLevels && !((updateCount >> aligned) & 1)) {
+		aligned++;
+	}
+	const float h = stepTime;
+	activeCount = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (!isActive(i)) {
+			continue;
+		}
+		activeCount++;
+		float &vx = Joints.vx[i], &vy = Joints.vy[i];
+		const float ax = Joints.ax[i], ay = Joints.ay[i];
+		float speed = sqrt(vx * vx + vy * vy);
+		float accelerationSize = sqrt(ax * ax + ay * ay);
+		float reach = multiRateTolerance * Joints.size[i];
+		float limit = INFINITY;
+		if (speed > 0) {
+			limit = reach / speed;
+		}
+		if (accelerationSize > 0) {
+			limit = std::min(limit, (float)sqrt(2 * reach / accelerationSize));
+		}
+		unsigned level = 0;
+		while (level < aligned && h * (2u << level) <= limit) {
+			level++;
+		}
+		Joints.level[i] = level;
+		const float step = h * (1u << level);
+		vx += ax * step;
+		vy += ay * step;
+	}
+}
+
+
+// Sweeps Joint i from its position at the start of the update to its current one against the continuous
+// Lines, so a fast Joint cannot pass through a thin Line between updates. At the earliest time of impact
+// it rebounds as in Line::checkCollide, leaving along the Line's normal, and covers the rest of the update
+// from there. The new path is swept again, up to a few hits per update.
+void Environment::sweepLines(size_t i) {
+	const unsigned MaxHits = 4;
+	float fromX = SweepX[i];
+	float fromY = SweepY[i];
+	float remaining = stepTime;
+	const float radius = Joints.size[i];
+	for (unsigned hit = 0; hit < MaxHits; hit++) {
+		const float toX = Joints.x[i];
+		const float toY = Joints.y[i];
+		Rect bound(std::min(fromX, toX) - radius, std::min(fromY, toY) - radius,
+			fabs(toX - fromX) + radius * 2, fabs(toY - fromY) + radius * 2);
+		float toi = INFINITY, nx = 0, ny = 0;
+		lineBVH.query(bound, [&](unsigned l) {
+			Line *line = Lines[l];
+			float lineNx, lineNy;
+			if (allowContinuousCollide || line->continuous) {
+				float t = line->sweep(fromX, fromY, toX, toY, radius, lineNx, lineNy);
+				if (t < toi) {
+					toi = t;
+					nx = lineNx;
+					ny = lineNy;
+				}
+			}
+		});
+		if (toi > 1) {
+			return;
+		}
+		// The same rebound and clearance of 1 as Line::checkCollide.
+		float speed = hypot(Joints.vx[i], Joints.vy[i]) * Joints.elasticity[i];
+		Joints.vx[i] = nx * speed;
+		Joints.vy[i] = ny * speed;
+		remaining *= 1 - toi;
+		fromX += (toX - fromX) * toi + nx;
+		fromY += (toY - fromY) * toi + ny;
+		Joints.x[i] = fromX + Joints.vx[i] * remaining;
+		Joints.y[i] = fromY + Joints.vy[i] * remaining;
+	}
+}
+
+
+// Adds acceleration (ax, ay) from a force to Joint i. Semi-implicit Euler applies it to the velocity over
+// the current step; velocity Verlet collects it for the second half kick at the end of the update.
+// Multi-rate stepping collects it only for Joints whose forces are due, which makes forces between
+// Joints of different steps one-sided: each end feels the other at its own rate.
+void Environment::accelerateJoint(size_t i, float ax, float ay) {
+	if (allowMultiRate) {
+		if (isActive(i)) {
+			Joints.ax[i] += ax;
+			Joints.ay[i] += ay;
+		}
+	} else if (integrator == Integrator::VelocityVerlet) {
+		Joints.ax[i] += ax;
+		Joints.ay[i] += ay;
+	} else {
+		Joints.vx[i] += ax * stepTime;
+		Joints.vy[i] += ay * stepTime;
+	}
+}
+
+
+// Attracts Joints i and j towards each other, as Joint::attract does.
+void Environment::attractPair(size_t i, size_t j) {
+	float dx = Joints.x[i] - Joints.x[j];
+	float dy = Joints.y[i] - Joints.y[j];
+	float distanceSquared = dx * dx + dy * dy;
+	float scale = 0.2f / (distanceSquared * sqrt(distanceSquared));
+	float towardsThis = scale * Joints.mass[i];
+	float towardsOther = scale * Joints.mass[j];
+	accelerateJoint(i, -dx * towardsOther, -dy * towardsOther);
+	accelerateJoint(j, dx * towardsThis, dy * towardsThis);
+}
+
+
+// Accelerates the ends of spring i towards each other or apart, as Spring::update does.
+void Environment::pullSpring(size_t i) {
+	const uint32_t a = Springs.ends[i].first;
+	const uint32_t b = Springs.ends[i].second;
+	float dx = Joints.x[a] - Joints.x[b];
+	float dy = Joints.y[a] - Joints.y[b];
+	float separation = sqrt(dx * dx + dy * dy);
+	float distance = separation - Springs.length[i];
+	float force = (Springs.length[i] - distance) * Springs.strength[i];
+	// Unit vector pointing from b towards a.
+	float nx = 1, ny = 0;
+	if (separation > 0) {
+		nx = dx / separation;
+		ny = dy / separation;
+	}
+	accelerateJoint(a, nx * force / Joints.mass[a], ny * force / Joints.mass[a]);
+	accelerateJoint(b, -nx * force / Joints.mass[b], -ny * force / Joints.mass[b]);
+}
+
+
+// Moves the ends of spring i towards its rest length: one XPBD projection with compliance 1 / strength,
+// weighted by inverse mass. Velocities take up the correction spread over the step.
+void Environment::projectSpring(size_t i) {
+	const uint32_t a = Springs.ends[i].first;
+	const uint32_t b = Springs.ends[i].second;
+	float dx = Joints.x[a] - Joints.x[b];
+	float dy = Joints.y[a] - Joints.y[b];
+	float separation = sqrt(dx * dx + dy * dy);
+	if (separation == 0 || Springs.strength[i] <= 0) {
+		return;
+	}
+	float nx = dx / separation;
+	float ny = dy / separation;
+	float weightA = 1 / Joints.mass[a];
+	float weightB = 1 / Joints.mass[b];
+	float compliance = 1 / (Springs.strength[i] * stepTime * stepTime);
+	float stretch = separation - Springs.length[i];
+	float delta = (-stretch - compliance * Springs.lambda[i]) / (weightA + weightB + compliance);
+	Springs.lambda[i] += delta;
+	Joints.x[a] += weightA * delta * nx;
+	Joints.y[a] += weightA * delta * ny;
+	Joints.vx[a] += weightA * delta * nx / stepTime;
+	Joints.vy[a] += weightA * delta * ny / stepTime;
+	Joints.x[b] -= weightB * delta * nx;
+	Joints.y[b] -= weightB * delta * ny;
+	Joints.vx[b] -= weightB * delta * nx / stepTime;
+	Joints.vy[b] -= weightB * delta * ny / stepTime;
+}
+
+
+// Bounces Joints begin to end - 1 off the walls for the impulse solver. A Joint touching a wall, within
+// ContactSlop, and moving into it faster than restSpeed bounces off as in Kernels::bounce; a slower one
+// stops against it, so a pile resting on the floor is not bounced.
+void Environment::bounceWalls(size_t begin, size_t end, float restSpeed) {
+	if (!allowBounce) {
+		return;
+	}
+	for (size_t i = begin; i < end; i++) {
+		const float x = Joints.x[i], y = Joints.y[i];
+		const float size = Joints.size[i], elasticity = Joints.elasticity[i];
+		float &vx = Joints.vx[i], &vy = Joints.vy[i];
+		if ((x < size + ContactSlop && vx < 0) || (x > width - size - ContactSlop && vx > 0)) {
+			if (fabs(vx) > restSpeed) {
+				vx = -vx * elasticity;
+				vy *= elasticity;
+			} else {
+				vx = 0;
 			}
-			if (allowCombine) {
-				j->combine(otherJoint);
+		}
+		if ((y < size + ContactSlop && vy < 0) || (y > height - size - ContactSlop && vy > 0)) {
+			if (fabs(vy) > restSpeed) {
+				vx *= elasticity;
+				vy = -vy * elasticity;
+			} else {
+				vy = 0;
 			}
 		}
 	}
-	for (int i = 0; i < Lines.size(); i++) {
-			Line *line = Lines[i];
-			for (int i = 0; i < Joints.size(); i++) {
-				Joint *joint = Joints[i];
-				if (allowCollide) {
-						line->checkCollide(joint);
+}
+
+
+// Holds up Joints begin to end - 1 against the walls they touch, within ContactSlop, in an iteration of the
+// impulse solver. Like a contact, each wall builds up an impulse over the iterations that only pushes,
+// so it gives back what it no longer needs when the contacts on a Joint ease off.
+void Environment::holdWalls(size_t begin, size_t end) {
+	if (!allowBounce) {
+		return;
+	}
+	for (size_t i = begin; i < end; i++) {
+		const float size = Joints.size[i], mass = Joints.mass[i];
+		// Each axis has a wall the Joint can touch; inwards is the direction pointing away from it.
+		float inwardsX = 0, inwardsY = 0;
+		if (Joints.x[i] < size + ContactSlop) {
+			inwardsX = 1;
+		} else if (Joints.x[i] > width - size - ContactSlop) {
+			inwardsX = -1;
+		}
+		if (Joints.y[i] < size + ContactSlop) {
+			inwardsY = 1;
+		} else if (Joints.y[i] > height - size - ContactSlop) {
+			inwardsY = -1;
+		}
+		if (inwardsX != 0) {
+			float impulse = std::max(WallImpulseX[i] - mass * inwardsX * Joints.vx[i], 0.0f);
+			Joints.vx[i] += inwardsX * (impulse - WallImpulseX[i]) / mass;
+			WallImpulseX[i] = impulse;
+		}
+		if (inwardsY != 0) {
+			float impulse = std::max(WallImpulseY[i] - mass * inwardsY * Joints.vy[i], 0.0f);
+			Joints.vy[i] += inwardsY * (impulse - WallImpulseY[i]) / mass;
+			WallImpulseY[i] = impulse;
+		}
+	}
+}
+
+
+// Puts Joints begin to end - 1 that were moved past a wall back against it, for the impulse solver.
+void Environment::clampWalls(size_t begin, size_t end) {
+	if (!allowBounce) {
+		return;
+	}
+	for (size_t i = begin; i < end; i++) {
+		const float size = Joints.size[i];
+		Joints.x[i] = std::min(std::max(Joints.x[i], size), width - size);
+		Joints.y[i] = std::min(std::max(Joints.y[i], size), height - size);
+	}
+}
+
+
+// Applies an impulse along the normal of contact i, pushing its first Joint away from its second.
+void Environment::pushContact(size_t i, float impulse) {
+	if (Contacts.mass[i] == 0 || impulse == 0) {
+		return;
+	}
+	const uint32_t a = PairJoints[i].first;
+	const uint32_t b = PairJoints[i].second;
+	Joints.vx[a] += Contacts.nx[i] * impulse / Joints.mass[a];
+	Joints.vy[a] += Contacts.ny[i] * impulse / Joints.mass[a];
+	Joints.vx[b] -= Contacts.nx[i] * impulse / Joints.mass[b];
+	Joints.vy[b] -= Contacts.ny[i] * impulse / Joints.mass[b];
+}
+
+
+// Moves the Joints of contact i apart by ContactRelax of their overlap beyond ContactSlop, in inverse
+// proportion to their masses. Their velocities are left alone, so the correction adds no energy.
+void Environment::relaxContact(size_t i) {
+	if (Contacts.mass[i] == 0) {
+		return;
+	}
+	const uint32_t a = PairJoints[i].first;
+	const uint32_t b = PairJoints[i].second;
+	float dx = Joints.x[a] - Joints.x[b];
+	float dy = Joints.y[a] - Joints.y[b];
+	float distance = sqrt(dx * dx + dy * dy);
+	float depth = Joints.size[a] + Joints.size[b] - distance;
+	if (depth <= ContactSlop) {
+		return;
+	}
+	float nx = 1, ny = 0;
+	if (distance > 0) {
+		nx = dx / distance;
+		ny = dy / distance;
+	}
+	float shift = ContactRelax * (depth - ContactSlop) / (Joints.mass[a] + Joints.mass[b]);
+	Joints.x[a] += nx * shift * Joints.mass[b];
+	Joints.y[a] += ny * shift * Joints.mass[b];
+	Joints.x[b] -= nx * shift * Joints.mass[a];
+	Joints.y[b] -= ny * shift * Joints.mass[a];
+}
+
+
+// Corrects the impulse of contact i so that its Joints separate at the speed restitution asks for.
+// The impulse built up over the iterations can only push, never pull the Joints together.
+void Environment::solveContact(size_t i) {
+	if (Contacts.mass[i] == 0) {
+		return;
+	}
+	const uint32_t a = PairJoints[i].first;
+	const uint32_t b = PairJoints[i].second;
+	float separating = (Joints.vx[a] - Joints.vx[b]) * Contacts.nx[i] + (Joints.vy[a] - Joints.vy[b]) * Contacts.ny[i];
+	float impulse = std::max(Contacts.impulse[i] + Contacts.mass[i] * (Contacts.bounce[i] - separating), 0.0f);
+	float delta = impulse - Contacts.impulse[i];
+	Contacts.impulse[i] = impulse;
+	pushContact(i, delta);
+}
+
+
+// Resolves the touching pair Pairs[i]: a pair of Joints, or a Joint and a Line from sweep and prune.
+void Environment::resolvePair(size_t i) {
+	const CollidableId &first = Pairs[i].first->data;
+	const CollidableId &second = Pairs[i].second->data;
+	if (first.kind != JointCollidable || second.kind != JointCollidable) {
+		if (allowCollide && (first.kind == JointCollidable || second.kind == JointCollidable)) {
+			const CollidableId &joint = first.kind == JointCollidable ? first : second;
+			const CollidableId &line = first.kind == JointCollidable ? second : first;
+			if (Lines[line.index]->checkCollide(Joints.handles[joint.index]) && instrumenting) {
+				touches.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		return;
+	}
+	if (allowCollide && contactSolver == ContactSolver::Bounce) {
+		if (Joint::collide(&Joints, first.index, &Joints, second.index) && instrumenting) {
+			touches.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	if (allowCombine) {
+		Joints.handles[first.index]->combine(Joints.handles[second.index]);
+	}
+}
+
+
+// Returns the index of the Joint held by a Collidable, or PairBatches::None for a Line.
+static uint32_t getJointIndex(Collidable *c) {
+	return c->data.kind == JointCollidable ? c->data.index : PairBatches::None;
+}
+
+
+// Advances the simulation by dt in fixed steps of setTimeStep, each split into substeps updates.
+// Time short of a whole step stays in the accumulator for the next call, and getInterpolation tells
+// how far into the next step it reaches. At most setMaxSteps steps run per call and time beyond them
+// is dropped, so one slow frame cannot make the next one slower still. Returns the number of steps taken.
+unsigned Environment::step(float dt, unsigned substeps) {
+	substeps = std::max(substeps, 1u);
+	accumulator += dt;
+	unsigned steps = 0;
+	while (accumulator >= timeStep && steps < maxSteps) {
+		for (unsigned i = 0; i < substeps; i++) {
+			update(timeStep / substeps);
+		}
+		accumulator -= timeStep;
+		steps++;
+	}
+	if (accumulator >= timeStep) {
+		accumulator = fmod(accumulator, timeStep);
+	}
+	return steps;
+}
+
+
+// Updates all Joints and springs in the environment over dt units of time. An update of 1 is one unit,
+// the time in which a Joint moves by its velocity.
+// Work that writes to two Joints runs in batches that never share a Joint, so the outcome
+// does not depend on the number of workers. Sleeping Joints are skipped until something wakes them.
+void Environment::update(float dt) {
+	// Instrumentation only costs a clock read per phase, and counting the work in the parallel parts.
+	instrumenting = allowInstrument || allowTrace;
+	std::fill(std::begin(phaseTimes), std::end(phaseTimes), 0.0);
+	std::fill(std::begin(counters), std::end(counters), 0);
+	if (instrumenting) {
+		touches = 0;
+		phaseStart = std::chrono::steady_clock::now();
+	}
+	stepTime = dt;
+	updateCount++;
+	applyCommands();
+	for (uint32_t island : Joints.wakeRequests) {
+		wakeIsland(island);
+	}
+	Joints.wakeRequests.clear();
+	// Moved Lines and attraction reach Joints without touching them, so they wake everything.
+	if ((linesMoved || allowAttract) && awakeCount < Joints.count()) {
+		wakeAll();
+	}
+	if (reorderInterval && ++updatesSinceReorder >= reorderInterval) {
+		reorder();
+	}
+	endPhase(Phase::Prepare);
+	const size_t count = Joints.count();
+	const float *x = Joints.x.data();
+	const float *y = Joints.y.data();
+	float *vx = Joints.vx.data();
+	float *vy = Joints.vy.data();
+	const float *size = Joints.size.data();
+	// collideWith reports the Joint combined with during this update only, so it never outlives a removed Joint.
+	std::fill(Joints.collideWith.begin(), Joints.collideWith.end(), nullptr);
+	StepDrag.resize(count);
+	// Joints are swept against continuous Lines from where they start the update.
+	const bool sweep = allowCollide && std::any_of(Lines.begin(), Lines.end(), [this](Line *line) {
+		return allowContinuousCollide || line->continuous;
+	});
+	if (sweep) {
+		SweepX.assign(x, x + awakeCount);
+		SweepY.assign(y, y + awakeCount);
+	}
+	threadPool.parallelFor(awakeCount, [this](size_t begin, size_t end) {
+		integrate(begin, end);
+	});
+	// Contacts can wake Joints later in the update. They were not integrated, so the closing kick leaves them out.
+	const size_t integrated = awakeCount;
+	// Velocity Verlet, and multi-rate stepping for the Joints due, gather this update's accelerations,
+	// starting from gravity.
+	const bool verlet = !allowMultiRate && integrator == Integrator::VelocityVerlet;
+	if (verlet || allowMultiRate) {
+		float gx = 0, gy = 0;
+		if (allowAccelerate) {
+			gx = sin(acceleration.angle) * acceleration.speed;
+			gy = -cos(acceleration.angle) * acceleration.speed;
+		}
+		for (size_t i = 0; i < integrated; i++) {
+			if (!allowMultiRate || isActive(i)) {
+				Joints.ax[i] = gx;
+				Joints.ay[i] = gy;
+			}
+		}
+	}
+	endPhase(Phase::Integrate);
+	const bool usePairs = allowCollide || allowCombine;
+	const bool useBarnesHut = allowAttract && allowBarnesHut;
+	const bool useTree = (usePairs && broadPhase == BroadPhase::QuadTree) || useBarnesHut;
+	if (usePairs || useTree) {
+		for (size_t i = 0; i < awakeCount; i++) {
+			Collidable *c = Collidables[i];
+			c->bound.x = x[i] - size[i];
+			c->bound.y = y[i] - size[i];
+			c->bound.width = c->bound.height = size[i] * 2;
+			c->mass = Joints.mass[i];
+		}
+		if (grid) {
+			// Cells as wide as the largest Joint keep every touching pair in neighbouring cells.
+			float maxSize = 0;
+			for (size_t i = 0; i < count; i++) {
+				maxSize = std::max(maxSize, size[i]);
+			}
+			grid->setCellSize(std::max(2 * maxSize, 1.0f));
+		}
+	}
+	// Only Joints that left the margin around their last placement move within the QuadTree.
+	if (useTree) {
+		size_t reinserts = 0;
+		for (size_t i = 0; i < awakeCount; i++) {
+			reinserts += quadTree->refit(Collidables[i]);
+		}
+		quadTree->updateDirty();
+		if (instrumenting) {
+			counters[(int)Counter::TreeReinserts] = reinserts;
+			counters[(int)Counter::TreeNodes] = quadTree->totalChildren();
+		}
+	}
+	// Allows interaction between touching Joints, each pair found once by the broad phase.
+	Pairs.clear();
+	PairJoints.clear();
+	if (usePairs) {
+		if (broadPhase == BroadPhase::Grid) {
+			grid->rebuild(Collidables);
+			grid->getIntersectingPairs(Pairs);
+		} else if (broadPhase == BroadPhase::SweepAndPrune) {
+			for (size_t i = 0; i < Lines.size(); i++) {
+				LineCollidables[i]->bound = getLineBound(Lines[i]);
+			}
+			sweepAndPrune->update();
+			sweepAndPrune->getIntersectingPairs(Pairs);
+		} else if (broadPhase == BroadPhase::LinearQuadTree) {
+			linearTree->build(Collidables, &threadPool);
+			linearTree->getIntersectingPairs(Pairs, &threadPool);
+		} else if (awakeCount * 4 < count) {
+			// Once most Joints sleep, only the awake ones look for partners; pairs of sleeping Joints are never needed.
+			for (size_t i = 0; i < awakeCount; i++) {
+				Collidable *c = Collidables[i];
+				quadTree->query(c->bound, [&](Collidable *other) {
+					if (other->data.index >= awakeCount || other->data.index > i) {
+						Pairs.push_back({c, other});
+					}
+				});
+			}
+		} else {
+			quadTree->getIntersectingPairs(Pairs);
+		}
+		if (instrumenting) {
+			counters[(int)Counter::CandidatePairs] = Pairs.size();
+		}
+		// An awake Joint touching a sleeping one wakes its island. Pairs still holding a sleeping Joint
+		// are dropped, as resolving them would move it; any contact left is found again next update.
+		if (awakeCount < count) {
+			for (const std::pair<Collidable*, Collidable*> &pair : Pairs) {
+				uint32_t a = getJointIndex(pair.first);
+				uint32_t b = getJointIndex(pair.second);
+				if (a == PairBatches::None || b == PairBatches::None || (a < awakeCount) == (b < awakeCount)) {
+					continue;
+				}
+				float dx = x[a] - x[b];
+				float dy = y[a] - y[b];
+				float reach = size[a] + size[b];
+				if (dx * dx + dy * dy < reach * reach) {
+					wakeIsland(Joints.island[a < awakeCount ? b : a]);
+				}
+			}
+			Pairs.erase(std::remove_if(Pairs.begin(), Pairs.end(), [this](const std::pair<Collidable*, Collidable*> &pair) {
+				uint32_t a = getJointIndex(pair.first);
+				uint32_t b = getJointIndex(pair.second);
+				return (a != PairBatches::None && a >= awakeCount) || (b != PairBatches::None && b >= awakeCount);
+			}), Pairs.end());
+		}
+		PairJoints.resize(Pairs.size());
+		for (size_t i = 0; i < Pairs.size(); i++) {
+			PairJoints[i] = {getJointIndex(Pairs[i].first), getJointIndex(Pairs[i].second)};
+		}
+		PairOrder.build(PairJoints, count);
+		// Every pair holding a Joint is tested when colliding, by the impulse solver's contacts or as it is resolved.
+		if (instrumenting && allowCollide) {
+			counters[(int)Counter::NarrowTests] = std::count_if(PairJoints.begin(), PairJoints.end(), [](const std::pair<uint32_t, uint32_t> &pair) {
+				return pair.first != PairBatches::None || pair.second != PairBatches::None;
+			});
+		}
+		endPhase(Phase::BroadPhase);
+		auto inBatches = [this](auto resolve) {
+			for (size_t batch = 0; batch < PairOrder.count(); batch++) {
+				const uint32_t *order = PairOrder.order.data() + PairOrder.starts[batch];
+				threadPool.parallelFor(PairOrder.starts[batch + 1] - PairOrder.starts[batch], [&resolve, order](size_t begin, size_t end) {
+					for (size_t i = begin; i < end; i++) {
+						resolve(order[i]);
+					}
+				});
+			}
+		};
+		const bool impulses = allowCollide && contactSolver == ContactSolver::Impulse;
+		// Contacts slower than gravity's pull over the update come to rest instead of bouncing.
+		const float restSpeed = Stable + (allowAccelerate ? acceleration.speed * stepTime : 0);
+		if (impulses) {
+			Contacts.build(PairJoints, Joints, restSpeed, allowWarmStart);
+		}
+		inBatches([this](size_t i) { resolvePair(i); });
+		// Joints first bounce off the walls they hit. The contacts then apply the impulses they start from
+		// and correct them over the iterations, the walls holding up what rests on them. Joints already
+		// moved by their velocity this update, so each then moves by its change in velocity as well,
+		// which is as if it had moved by the solved velocity. Last, touching Joints are moved apart.
+		if (impulses) {
+			threadPool.parallelFor(awakeCount, [this, restSpeed](size_t begin, size_t end) {
+				bounceWalls(begin, end, restSpeed);
+			});
+			ContactVx.assign(vx, vx + awakeCount);
+			ContactVy.assign(vy, vy + awakeCount);
+			WallImpulseX.assign(awakeCount, 0);
+			WallImpulseY.assign(awakeCount, 0);
+			inBatches([this](size_t i) { pushContact(i, Contacts.impulse[i]); });
+			for (unsigned iteration = 0; iteration <= contactIterations; iteration++) {
+				threadPool.parallelFor(awakeCount, [this](size_t begin, size_t end) {
+					holdWalls(begin, end);
+				});
+				if (iteration < contactIterations) {
+					inBatches([this](size_t i) { solveContact(i); });
+				}
+			}
+			threadPool.parallelFor(ContactVx.size(), [this](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					Joints.x[i] += (Joints.vx[i] - ContactVx[i]) * stepTime;
+					Joints.y[i] += (Joints.vy[i] - ContactVy[i]) * stepTime;
+				}
+				getKernels().settle(Joints.vx.data() + begin, Joints.vy.data() + begin, Stable * stepTime, end - begin);
+			});
+			for (unsigned iteration = 0; iteration < contactIterations; iteration++) {
+				inBatches([this](size_t i) { relaxContact(i); });
+				threadPool.parallelFor(awakeCount, [this](size_t begin, size_t end) {
+					clampWalls(begin, end);
+				});
+			}
+			Contacts.keep();
+			if (instrumenting) {
+				touches += Contacts.contacts;
+			}
+		}
+		endPhase(Phase::Contacts);
+	}
+	// Barnes-Hut approximates the pull of distant groups of Joints by their centre of mass.
+	if (useBarnesHut) {
+		quadTree->updateMass();
+		threadPool.parallelFor(count, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				if (allowMultiRate && !isActive(i)) {
+					continue;
+				}
+				double ax = 0, ay = 0;
+				quadTree->getAttraction(Collidables[i], barnesHutTheta, ax, ay);
+				// Same strength as Joint::attract.
+				accelerateJoint(i, 0.2f * ax, 0.2f * ay);
+			}
+		});
+	// Exact attraction acts at any distance, so every pair is visited.
+	} else if (allowAttract) {
+		for (size_t i = 0; i < count; i++) {
+			for (size_t j = i + 1; j < count; j++) {
+				if (!allowMultiRate || isActive(i) || isActive(j)) {
+					attractPair(i, j);
+				}
+			}
+		}
+	}
+	endPhase(Phase::Attraction);
+	// Each Joint only meets the Lines the hierarchy finds around it. Sweep and prune already paired them,
+	// but only at their current positions, so sweeping still goes through the hierarchy.
+	const bool discreteLines = allowCollide && !Lines.empty() && broadPhase != BroadPhase::SweepAndPrune;
+	if ((discreteLines || sweep) && linesMoved) {
+		std::vector<Rect> bounds;
+		for (size_t i = 0; i < Lines.size(); i++) {
+			bounds.push_back(getLineBound(Lines[i]));
+		}
+		lineBVH.build(bounds);
+		linesMoved = false;
+	}
+	// Joints woken by a touch during this update have not moved, and are left out.
+	if (sweep) {
+		threadPool.parallelFor(SweepX.size(), [this](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				sweepLines(i);
+			}
+		});
+	}
+	if (discreteLines) {
+		std::atomic<size_t> lineTests{0};
+		threadPool.parallelFor(awakeCount, [&](size_t begin, size_t end) {
+			size_t tests = 0, hits = 0;
+			for (size_t i = begin; i < end; i++) {
+				Joint *joint = Joints.handles[i];
+				lineBVH.query(Rect(x[i] - size[i], y[i] - size[i], size[i] * 2, size[i] * 2), [&](unsigned l) {
+					tests++;
+					hits += Lines[l]->checkCollide(joint);
+				});
+			}
+			if (instrumenting) {
+				lineTests.fetch_add(tests, std::memory_order_relaxed);
+				touches.fetch_add(hits, std::memory_order_relaxed);
+			}
+		});
+		counters[(int)Counter::NarrowTests] += lineTests;
+	}
+	endPhase(Phase::Lines);
+	// Springs run in batches that never share a Joint. The batches only change along with the springs:
+	// Joints changing slots relabels the ends but keeps every batch free of shared Joints.
+	if (springsChanged) {
+		SpringOrder.build(Springs.ends, count);
+		springsChanged = false;
+	}
+	const bool project = springSolver == SpringSolver::XPBD;
+	const unsigned iterations = project ? springIterations : 1;
+	if (project) {
+		std::fill(Springs.lambda.begin(), Springs.lambda.end(), 0.0f);
+	}
+	for (unsigned iteration = 0; iteration < iterations; iteration++) {
+		for (size_t batch = 0; batch < SpringOrder.count(); batch++) {
+			const uint32_t *order = SpringOrder.order.data() + SpringOrder.starts[batch];
+			threadPool.parallelFor(SpringOrder.starts[batch + 1] - SpringOrder.starts[batch], [this, order, project](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					// Springs between sleeping Joints rest along with them.
+					const std::pair<uint32_t, uint32_t> &ends = Springs.ends[order[i]];
+					if (ends.first >= awakeCount && ends.second >= awakeCount) {
+						continue;
+					}
+					if (project) {
+						projectSpring(order[i]);
+					} else {
+						pullSpring(order[i]);
+					}
 				}
+			});
+		}
+	}
+	endPhase(Phase::Springs);
+	// The second half of velocity Verlet's kick, with the accelerations of this update.
+	if (verlet) {
+		const float h = stepTime;
+		for (size_t i = 0; i < integrated; i++) {
+			vx[i] += 0.5f * h * Joints.ax[i];
+			vy[i] += 0.5f * h * Joints.ay[i];
 		}
+	} else if (allowMultiRate) {
+		kickMultiRate(integrated);
 	}
-	for (int i = 0; i < Springs.size(); i++) {
-		Spring *spring = Springs[i];
-		spring->update();
+	if (allowSleep && !allowAttract) {
+		sleepIslands();
 	}
-	
+	if (allowSnapshots) {
+		publishSnapshot();
+	}
+	endPhase(Phase::Finish);
+	if (instrumenting) {
+		counters[(int)Counter::Contacts] = touches;
+	}
+	if (allowTrace) {
+		TraceCount traceCount;
+		traceCount.time = TraceSpans.back().start + TraceSpans.back().duration;
+		std::copy(std::begin(counters), std::end(counters), std::begin(traceCount.counters));
+		TraceCounts.push_back(traceCount);
+	}
+}
+
+
+// Records the time since the last phase ended, or since the update began, as the time of phase.
+// Without pairs to find, the bounds kept for Barnes-Hut are counted along with attraction.
+void Environment::endPhase(Phase phase) {
+	if (!instrumenting) {
+		return;
+	}
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	phaseTimes[(int)phase] = std::chrono::duration<double, std::milli>(now - phaseStart).count();
+	if (allowTrace) {
+		TraceSpans.push_back({phase, std::chrono::duration<double, std::micro>(phaseStart - traceStart).count(),
+			std::chrono::duration<double, std::micro>(now - phaseStart).count()});
+	}
+	phaseStart = now;
+}
+
+
+// Queues adding a Joint, as addJoint. added, if given, is called with its handle once it is added,
+// on the thread updating the Environment.
+void Environment::queueAddJoint(float x, float y, float size, float mass, float speed, float angle, float elasticity,
+		std::function<void(JointHandle)> added) {
+	Command *command = Commands.make(Command::AddJoint);
+	command->x = x;
+	command->y = y;
+	command->size = size;
+	command->mass = mass;
+	command->speed = speed;
+	command->angle = angle;
+	command->elasticity = elasticity;
+	command->added = std::move(added);
+	Commands.push(command);
+}
+
+
+// Queues tying two Joints with a spring, as addSpring.
+void Environment::queueAddSpring(JointHandle p1, JointHandle p2, float length, float strength) {
+	Command *command = Commands.make(Command::AddSpring);
+	command->joint = p1;
+	command->other = p2;
+	command->length = length;
+	command->strength = strength;
+	Commands.push(command);
+}
+
+
+// Queues an impulse (ix, iy) on a Joint, changing its velocity by the impulse over its mass.
+void Environment::queueImpulse(JointHandle joint, float ix, float iy) {
+	Command *command = Commands.make(Command::Impulse);
+	command->joint = joint;
+	command->x = ix;
+	command->y = iy;
+	Commands.push(command);
+}
+
+
+// Queues moving a Joint towards (x, y), as Joint::moveTo.
+void Environment::queueMoveTo(JointHandle joint, float x, float y) {
+	Command *command = Commands.make(Command::MoveTo);
+	command->joint = joint;
+	command->x = x;
+	command->y = y;
+	Commands.push(command);
+}
+
+
+// Queues removing a Joint, as removeJoint.
+void Environment::queueRemoveJoint(JointHandle joint) {
+	Command *command = Commands.make(Command::RemoveJoint);
+	command->joint = joint;
+	Commands.push(command);
+}
+
+
+// Applies the Commands queued before the update started, in order, so producers pushing all the while
+// cannot hold the update up. Commands for Joints removed since they were queued do nothing.
+void Environment::applyCommands() {
+	for (size_t count = Commands.getPending(); count > 0; count--) {
+		Command *command = Commands.pop();
+		if (!command) {
+			break;
+		}
+		Joint *joint = JointPool.get(command->joint);
+		switch (command->kind) {
+		case Command::AddJoint: {
+			Joint *added = addJoint(command->x, command->y, command->size, command->mass, command->speed, command->angle, command->elasticity);
+			if (command->added) {
+				command->added(getHandle(added));
+			}
+			break;
+		}
+		case Command::RemoveJoint:
+			if (joint) {
+				removeJoint(joint);
+			}
+			break;
+		case Command::AddSpring: {
+			Joint *other = JointPool.get(command->other);
+			if (joint && other && joint != other) {
+				addSpring(joint, other, command->length, command->strength);
+			}
+			break;
+		}
+		case Command::MoveTo:
+			if (joint) {
+				joint->moveTo(command->x, command->y);
+			}
+			break;
+		case Command::Impulse:
+			if (joint && joint->getMass() != 0) {
+				joint->accelerate(command->x / joint->getMass(), command->y / joint->getMass());
+			}
+			break;
+		}
+		Commands.recycle(command);
+	}
+}
+
+
+// Copies the Joints' positions, sizes and ids into a free Snapshot and makes it the latest, for threads
+// reading the Environment while it updates (getSnapshot). Never waits for them: with every slot held,
+// the Snapshot is dropped and readers keep seeing the last one.
+void Environment::publishSnapshot() {
+	Snapshot *snapshot = Snapshots.write();
+	if (!snapshot) {
+		return;
+	}
+	const size_t count = Joints.count();
+	snapshot->update = updateCount;
+	snapshot->joints.resize(count);
+	snapshot->ids.resize(count);
+	threadPool.parallelFor(count, [this, snapshot](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			snapshot->joints[i] = {Joints.x[i], Joints.y[i], Joints.size[i]};
+			snapshot->ids[i] = Joints.id[i];
+		}
+	});
+	Snapshots.publish();
+}
+
+
+// Turns on recording the phases and counters of every update for writeTrace. The trace's times start
+// from when it was turned on.
+void Environment::setAllowTrace(bool setting) {
+	if (setting && !allowTrace) {
+		traceStart = std::chrono::steady_clock::now();
+	}
+	allowTrace = setting;
+}
+
+
+// Writes the recorded updates to path in the Chrome trace event format, for chrome://tracing or Perfetto:
+// a span per phase and a counter track per Counter. Returns whether the file was written.
+bool Environment::writeTrace(const std::string &path) {
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (const TraceSpan &span : TraceSpans) {
+		fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"update\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+			first ? "" : ",\n", getPhaseName(span.phase), span.start, span.duration);
+		first = false;
+	}
+	for (const TraceCount &count : TraceCounts) {
+		for (int counter = 0; counter < (int)Counter::Count; counter++) {
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"%s\":%zu}}",
+				first ? "" : ",\n", getCounterName((Counter)counter), count.time, getCounterName((Counter)counter), count.counters[counter]);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+
+// Returns the snake_case name of phase, as used in traces and reports.
+const char * Environment::getPhaseName(Phase phase) {
+	static const char *Names[] = {"prepare", "integrate", "broad_phase", "contacts", "attraction", "lines", "springs", "finish"};
+	return Names[(int)phase];
+}
+
 
+// Returns the snake_case name of counter, as used in traces and reports.
+const char * Environment::getCounterName(Counter counter) {
+	static const char *Names[] = {"candidate_pairs", "narrow_tests", "contacts", "tree_reinserts", "tree_nodes"};
+	return Names[(int)counter];
 }